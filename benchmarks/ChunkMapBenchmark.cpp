@@ -0,0 +1,117 @@
+// Compares chunk lookup throughput of ChunkMap against std::unordered_map
+//	Build from the repository root, e.g.:
+//	  g++ -O2 -std=c++17 -Iinclude -Isrc benchmarks/ChunkMapBenchmark.cpp src/ChunkMap.cpp -o ChunkMapBenchmark
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+
+#include "ChunkMap.h"
+#include "WorldConstants.h"
+
+#include <unordered_map>
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <cstdint>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Chunks are never dereferenced, fake unique pointers from coords
+static Chunk *FakeChunk(glm::ivec2 coord)
+{
+	return reinterpret_cast<Chunk *>((uintptr_t(uint32_t(coord.x)) << 32 | uint32_t(coord.y)) * 16 + 16);
+}
+
+// Time a function and print lookups per second
+template <typename Func>
+static void Measure(const char *name, size_t count, Func func)
+{
+	auto start = Clock::now();
+	uintptr_t result = func();
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	std::cout << name << ": " << count / seconds / 1e6 << " M/s (checksum " << (result & 0xFFFF) << ")" << std::endl;
+}
+
+int main()
+{
+	// Fill a render disk like the chunk manager does, centered away from the origin
+	int radius = int(400.0f / World::chunkSize) + 1;
+	glm::ivec2 center = { 32, -20 };
+
+	std::unordered_map<glm::ivec2, Chunk *> map;
+	ChunkMap chunkMap(size_t(4 * radius * radius));
+	for (int z = -radius; z <= radius; z++)
+	{
+		for (int x = -radius; x <= radius; x++)
+		{
+			if (x * x + z * z > radius * radius)
+				continue;
+
+			glm::ivec2 coord = center + glm::ivec2(x, z);
+			map[coord] = FakeChunk(coord);
+			chunkMap.Insert(coord, FakeChunk(coord));
+		}
+	}
+	std::cout << "Chunks: " << map.size() << std::endl;
+
+	// Lookups clustered like meshing and collision queries, some missing
+	const size_t lookupCount = 20000000;
+	std::vector<glm::ivec2> queries(1 << 16);
+	std::default_random_engine rng(1234);
+	std::uniform_int_distribution<int> dist(-radius - 2, radius + 2);
+	for (glm::ivec2 &q : queries)
+		q = center + glm::ivec2(dist(rng), dist(rng));
+
+	Measure("unordered_map lookup", lookupCount, [&]() {
+		uintptr_t sum = 0;
+		for (size_t i = 0; i < lookupCount; i++)
+		{
+			auto it = map.find(queries[i & (queries.size() - 1)]);
+			if (it != map.end())
+				sum += uintptr_t(it->second);
+		}
+		return sum;
+	});
+
+	Measure("ChunkMap lookup", lookupCount, [&]() {
+		uintptr_t sum = 0;
+		for (size_t i = 0; i < lookupCount; i++)
+			sum += uintptr_t(chunkMap.Find(queries[i & (queries.size() - 1)]));
+		return sum;
+	});
+
+	// Full iteration like drawing and updating chunks
+	const size_t passes = 20000;
+	Measure("unordered_map iterate", passes * map.size(), [&]() {
+		uintptr_t sum = 0;
+		for (size_t i = 0; i < passes; i++)
+			for (const auto &c : map)
+				sum += uintptr_t(c.second);
+		return sum;
+	});
+
+	Measure("ChunkMap iterate", passes * chunkMap.Size(), [&]() {
+		uintptr_t sum = 0;
+		for (size_t i = 0; i < passes; i++)
+			for (Chunk *chunk : chunkMap)
+				sum += uintptr_t(chunk);
+		return sum;
+	});
+
+	// Streaming churn, move the disk and erase chunks that left it
+	Measure("ChunkMap insert/erase", 2 * 100 * (2 * radius + 1), [&]() {
+		for (int step = 1; step <= 100; step++)
+		{
+			for (int z = -radius; z <= radius; z++)
+			{
+				chunkMap.Erase(center + glm::ivec2(step - 1 - radius, z));
+				glm::ivec2 coord = center + glm::ivec2(step + radius, z);
+				chunkMap.Insert(coord, FakeChunk(coord));
+			}
+		}
+		return uintptr_t(chunkMap.Size());
+	});
+
+	return 0;
+}
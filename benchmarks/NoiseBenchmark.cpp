@@ -0,0 +1,67 @@
+// Measures simplex noise samples per second at each instruction set level the cpu supports, against glm::simplex
+//	Build from the repository root, e.g.:
+//	  g++ -O2 -std=c++17 -Iinclude -Isrc benchmarks/NoiseBenchmark.cpp src/SimplexNoise.cpp src/SimplexNoiseSse41.cpp src/SimplexNoiseAvx2.cpp -o NoiseBenchmark
+
+#include "SimplexNoise.h"
+#include "WorldConstants.h"
+
+#include <glm/gtc/noise.hpp>
+
+#include <vector>
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <cstring>
+#include <iterator>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+int main()
+{
+	const size_t count = 1 << 20;
+	const int rounds = 8;
+
+	// Terrain grid corners at each noise layer's scale, like height map generation
+	std::default_random_engine rng(1234);
+	std::uniform_int_distribution<int> corner(-100000, 100000);
+	const float scales[] = { World::Generation::heightScale, World::Generation::detailScale, World::Generation::landScale };
+
+	std::vector<float> x(count), y(count), expected(count), out(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		float scale = scales[i % std::size(scales)];
+		x[i] = corner(rng) * World::Generation::terrainInterpGrid / scale;
+		y[i] = corner(rng) * World::Generation::terrainInterpGrid / scale;
+	}
+
+	// Reference
+	auto start = Clock::now();
+	for (int round = 0; round < rounds; round++)
+	{
+		for (size_t i = 0; i < count; i++)
+			expected[i] = glm::simplex(glm::vec2(x[i], y[i]));
+	}
+	double reference = count * rounds / std::chrono::duration<double>(Clock::now() - start).count();
+	std::cout << "glm::simplex: " << reference / 1e6 << " M samples/s" << std::endl;
+
+	// Each level up to the widest supported, results must match bit for bit
+	for (int level = 0; level <= SimplexNoise::GetSupportedLevel(); level++)
+	{
+		start = Clock::now();
+		for (int round = 0; round < rounds; round++)
+			SimplexNoise::Evaluate(x.data(), y.data(), out.data(), count, SimplexNoise::Level(level));
+		double rate = count * rounds / std::chrono::duration<double>(Clock::now() - start).count();
+
+		size_t mismatches = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			if (std::memcmp(&out[i], &expected[i], sizeof(float)) != 0)
+				mismatches++;
+		}
+
+		std::cout << SimplexNoise::GetLevelName(SimplexNoise::Level(level)) << ": " << rate / 1e6 << " M samples/s ("
+			<< rate / reference << "x), " << mismatches << " mismatches" << std::endl;
+	}
+
+	return 0;
+}
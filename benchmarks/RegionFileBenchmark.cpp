@@ -0,0 +1,169 @@
+// Measures chunk save and load throughput of region files against generating the chunks again
+//	Build from the repository root, e.g.:
+//	  g++ -O2 -std=c++17 -Iinclude -Isrc benchmarks/RegionFileBenchmark.cpp src/WorldStorage.cpp src/RegionFile.cpp src/FileSync.cpp src/BlockStorage.cpp src/TerrainGenerator.cpp src/SimplexNoise.cpp src/SimplexNoiseSse41.cpp src/SimplexNoiseAvx2.cpp -lpthread -o RegionFileBenchmark
+
+#include "WorldStorage.h"
+#include "RegionFile.h"
+#include "TerrainGenerator.h"
+#include "WorldConstants.h"
+
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <filesystem>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Terrain layers like Chunk::Generate, without trees
+static ChunkData GenerateChunk(TerrainGenerator &gen, glm::ivec2 coord)
+{
+	ChunkData data = { std::vector<BlockStorage>(World::sectionCount, BlockStorage(World::sectionVolume)), 0, false };
+
+	HeightMap heights;
+	gen.GenerateHeightMap(coord * int(World::chunkSize), glm::ivec2(World::chunkSize), heights);
+
+	for (int z = 0; z < int(World::chunkSize); z++)
+	{
+		for (int x = 0; x < int(World::chunkSize); x++)
+		{
+			int height = heights.Get(coord * int(World::chunkSize) + glm::ivec2(x, z));
+			data.highestSolidBlock = std::max(data.highestSolidBlock, height - 1);
+
+			for (int y = 0; y < height; y++)
+			{
+				Block block = { y < height - 8 ? Block::BLOCK_STONE : y < height - 1 ? Block::BLOCK_DIRT : Block::BLOCK_GRASS };
+				data.sections[y / World::sectionHeight].Set(x + (y % World::sectionHeight) * World::chunkArea + z * World::chunkSize, block);
+			}
+		}
+	}
+
+	for (BlockStorage &section : data.sections)
+		section.Compact();
+	return data;
+}
+
+// Hash of every block, to check loads match saves
+static uint64_t Checksum(const ChunkData &data)
+{
+	uint64_t hash = 1469598103934665603ull;
+	for (const BlockStorage &section : data.sections)
+	{
+		for (size_t i = 0; i < section.Size(); i++)
+			hash = (hash ^ section.Get(i).type) * 1099511628211ull;
+	}
+	return hash;
+}
+
+// Count loaded chunks that differ from the saved ones
+static size_t Mismatches(const std::vector<ChunkData> &loaded, const std::vector<uint64_t> &checksums)
+{
+	size_t mismatches = 0;
+	for (size_t i = 0; i < loaded.size(); i++)
+	{
+		if (loaded[i].sections.empty() || Checksum(loaded[i]) != checksums[i])
+			mismatches++;
+	}
+	return mismatches;
+}
+
+// Time a function and print chunks per second
+template <typename Func>
+static double Measure(const char *name, size_t count, Func func)
+{
+	auto start = Clock::now();
+	func();
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	std::cout << name << ": " << count / seconds << " chunks/s (" << seconds * 1e6 / count << " us/chunk)" << std::endl;
+	return seconds;
+}
+
+int main()
+{
+	const std::string directory = "RegionFileBenchmark_world";
+	std::filesystem::remove_all(directory);
+	std::filesystem::create_directories(directory);
+
+	// One full region, with some edits like a player would make
+	const int count = RegionFile::chunkCount;
+	TerrainGenerator gen;
+	std::vector<ChunkData> chunks(count);
+	std::vector<uint64_t> checksums(count);
+
+	Measure("Generate", count, [&]() {
+		for (int i = 0; i < count; i++)
+			chunks[i] = GenerateChunk(gen, { i % RegionFile::regionSize, i / RegionFile::regionSize });
+	});
+
+	std::default_random_engine rng(1234);
+	std::uniform_int_distribution<size_t> block(0, World::sectionVolume - 1);
+	for (int i = 0; i < count; i++)
+	{
+		for (int edit = 0; edit < 64; edit++)
+			chunks[i].sections[4].Set(block(rng), { Block::BLOCK_LOG });
+		checksums[i] = Checksum(chunks[i]);
+	}
+
+	// Encoding alone
+	std::vector<std::vector<unsigned char>> encoded(count);
+	size_t encodedBytes = 0;
+	Measure("Encode", count, [&]() {
+		for (int i = 0; i < count; i++)
+			WorldStorage::Encode(chunks[i], encoded[i]);
+	});
+	for (const std::vector<unsigned char> &bytes : encoded)
+		encodedBytes += bytes.size();
+	std::cout << "Encoded size: " << encodedBytes / count << " bytes/chunk, " << double(World::chunkVolume) * count / encodedBytes << "x smaller than a byte per block" << std::endl;
+
+	// Region file directly
+	{
+		RegionFile region(directory + "/direct.vxr");
+		double seconds = Measure("Region save", count, [&]() {
+			for (int i = 0; i < count; i++)
+			{
+				WorldStorage::Encode(chunks[i], encoded[i]);
+				region.Write(i % RegionFile::regionSize, i / RegionFile::regionSize, encoded[i].data(), encoded[i].size());
+			}
+		});
+		std::cout << "  " << encodedBytes / seconds / (1024 * 1024) << " MiB/s" << std::endl;
+
+		std::vector<ChunkData> loaded(count);
+		size_t failures = 0;
+		seconds = Measure("Region load", count, [&]() {
+			std::vector<unsigned char> bytes;
+			for (int i = 0; i < count; i++)
+			{
+				if (!region.Read(i % RegionFile::regionSize, i / RegionFile::regionSize, bytes) || !WorldStorage::Decode(bytes.data(), bytes.size(), loaded[i]))
+					failures++;
+			}
+		});
+		std::cout << "  " << encodedBytes / seconds / (1024 * 1024) << " MiB/s, " << failures + Mismatches(loaded, checksums) << " mismatches" << std::endl;
+	}
+
+	// Storage with its background save thread, the save is queued then flushed
+	{
+		WorldStorage storage(directory);
+		Measure("Storage save and flush", count, [&]() {
+			for (int i = 0; i < count; i++)
+				storage.Save({ i % RegionFile::regionSize, i / RegionFile::regionSize }, chunks[i]);
+			storage.Flush();
+		});
+	}
+	{
+		// New storage so nothing is served from the save queue
+		WorldStorage storage(directory);
+		std::vector<ChunkData> loaded(count);
+		size_t failures = 0;
+		Measure("Storage load", count, [&]() {
+			for (int i = 0; i < count; i++)
+			{
+				if (!storage.Load({ i % RegionFile::regionSize, i / RegionFile::regionSize }, loaded[i]))
+					failures++;
+			}
+		});
+		std::cout << "  " << failures + Mismatches(loaded, checksums) << " mismatches" << std::endl;
+	}
+
+	std::filesystem::remove_all(directory);
+	return 0;
+}
@@ -6,4 +6,17 @@
 #define SKY_COLOR 0.0, 0.3, 0.8
 #define SUN_COLOR 1.0, 0.8, 0.4
 #define LIGHT_DIR 0.5, 1.0, -0.7
-#define MAX_CASCADES 3
\ No newline at end of file
+#define MAX_CASCADES 3
+
+#define TILESHEET_SIZE 8
+
+// Packed chunk vertex, two 32 bit words, bit offsets of each field
+//   first: x (5), y (9), z (5), normal direction (3), ambient (2), quad corner (2)
+//   second: tile index (8), quad width (9), quad height (9)
+#define PACKED_Y_SHIFT 5
+#define PACKED_Z_SHIFT 14
+#define PACKED_NORMAL_SHIFT 19
+#define PACKED_AMBIENT_SHIFT 22
+#define PACKED_CORNER_SHIFT 24
+#define PACKED_WIDTH_SHIFT 8
+#define PACKED_HEIGHT_SHIFT 17
@@ -1,6 +1,8 @@
 out vec4 fragColor;
 
 in vec2 texCoord;
+flat in vec2 tile;
+flat in float tileSize;
 in vec3 normal;
 in float ambientV;
 in vec3 worldPosition;
@@ -81,8 +83,12 @@ void main()
 {
 	vec3 N = normalize(normal);
 
-	// Texture color
-	vec3 texColor = texture(tex, texCoord).rgb;
+	// Texture color, repeat atlas tile across merged faces (gradients from unwrapped coords avoid seams at tile edges)
+	vec3 texColor;
+	if (tileSize > 0.0)
+		texColor = textureGrad(tex, tile + min(fract(texCoord), 0.9999) * tileSize, dFdx(texCoord) * tileSize, dFdy(texCoord) * tileSize).rgb;
+	else
+		texColor = texture(tex, texCoord).rgb;
 
 	// View vector
 	vec3 view = worldPosition - cameraPosition;
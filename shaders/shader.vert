@@ -2,8 +2,11 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTex;
 layout (location = 2) in vec3 aNorm;
 layout (location = 3) in float aAmb;
+layout (location = 4) in uvec2 aPacked;
   
 out vec2 texCoord;
+flat out vec2 tile;
+flat out float tileSize;
 out vec3 normal;
 out float ambientV;
 out vec3 worldPosition;
@@ -11,16 +14,50 @@ out vec3 worldPosition;
 uniform mat4 modelMatrix;
 uniform mat3 normalMatrix;
 uniform mat4 cameraMatrix;
+uniform bool packedVertices; // chunk meshes use packed vertices, see Shared.h
+
+const vec3 directionVectors[6] = vec3[](
+	vec3(1.0, 0.0, 0.0), vec3(-1.0, 0.0, 0.0),
+	vec3(0.0, 1.0, 0.0), vec3(0.0, -1.0, 0.0),
+	vec3(0.0, 0.0, 1.0), vec3(0.0, 0.0, -1.0)
+);
 
 void main()
 {
+	vec3 position = aPos;
+	vec3 norm = aNorm;
+
+	// Unpack chunk vertex
+	if (packedVertices)
+	{
+		uint data = aPacked.x;
+		position = vec3(data & 31u, (data >> PACKED_Y_SHIFT) & 511u, (data >> PACKED_Z_SHIFT) & 31u);
+		norm = directionVectors[(data >> PACKED_NORMAL_SHIFT) & 7u];
+		ambientV = float((data >> PACKED_AMBIENT_SHIFT) & 3u);
+
+		// Corner uv stretched over the quad, repeating the atlas tile in the fragment shader
+		uint corner = (data >> PACKED_CORNER_SHIFT) & 3u;
+		uint texture = aPacked.y;
+		vec2 size = vec2((texture >> PACKED_WIDTH_SHIFT) & 511u, (texture >> PACKED_HEIGHT_SHIFT) & 511u);
+		texCoord = vec2(corner & 1u, corner >> 1u) * size;
+
+		uint index = texture & 255u;
+		tileSize = 1.0 / TILESHEET_SIZE;
+		tile = vec2(index % TILESHEET_SIZE, TILESHEET_SIZE - 1 - index / TILESHEET_SIZE) * tileSize;
+	}
+	else
+	{
+		texCoord = aTex;
+		tile = vec2(0.0);
+		tileSize = 0.0;
+		ambientV = aAmb;
+	}
+
 	// Transform vertices by MVP
-    vec4 world = modelMatrix * vec4(aPos, 1.0);
+    vec4 world = modelMatrix * vec4(position, 1.0);
 	worldPosition = world.xyz;
 	gl_Position = cameraMatrix * world;
 
 	// Forward variables to fragment shader
-    texCoord = aTex;
-	normal = normalMatrix * aNorm;
-	ambientV = aAmb;
+	normal = normalMatrix * norm;
 }
\ No newline at end of file
@@ -1,10 +1,19 @@
 layout (location = 0) in vec3 aPos;
+layout (location = 4) in uvec2 aPacked;
 
 uniform mat4 cameraMatrix;
 uniform mat4 modelMatrix;
+uniform bool packedVertices; // chunk meshes use packed vertices, see Shared.h
 
 void main()
 {
+	vec3 position = aPos;
+	if (packedVertices)
+	{
+		uint data = aPacked.x;
+		position = vec3(data & 31u, (data >> PACKED_Y_SHIFT) & 511u, (data >> PACKED_Z_SHIFT) & 31u);
+	}
+
 	// Transform vertices by MVP
-    gl_Position = cameraMatrix * modelMatrix * vec4(aPos, 1.0);
+    gl_Position = cameraMatrix * modelMatrix * vec4(position, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,164 @@
+#include "BlockStorage.h"
+
+BlockStorage::BlockStorage(size_t size, Block fill) : size_(size), bits_(0), palette_(1, fill)
+{
+}
+
+Block BlockStorage::Get(size_t index) const
+{
+	return palette_[GetIndex(index)];
+}
+
+void BlockStorage::Set(size_t index, Block block)
+{
+	// Uniform storage already holding this block
+	if (bits_ == 0 && palette_[0] == block)
+		return;
+
+	SetIndex(index, FindOrAdd(block));
+}
+
+void BlockStorage::Fill(Block block)
+{
+	palette_.assign(1, block);
+	data_.clear();
+	data_.shrink_to_fit();
+	bits_ = 0;
+}
+
+void BlockStorage::Compact()
+{
+	if (bits_ == 0)
+		return;
+
+	// Count uses of each palette entry
+	std::vector<size_t> counts(palette_.size(), 0);
+	for (size_t i = 0; i < size_; i++)
+		counts[GetIndex(i)]++;
+
+	// Build palette of used entries and old to new index mapping
+	std::vector<Block> palette;
+	std::vector<unsigned> remap(palette_.size(), 0);
+	for (size_t i = 0; i < palette_.size(); i++)
+	{
+		if (counts[i] == 0)
+			continue;
+
+		remap[i] = unsigned(palette.size());
+		palette.push_back(palette_[i]);
+	}
+
+	if (palette.size() == palette_.size())
+		return;
+
+	if (palette.size() == 1)
+	{
+		Fill(palette[0]);
+		return;
+	}
+
+	// Remap indices in place, then shrink entry size if the palette allows
+	for (size_t i = 0; i < size_; i++)
+		SetIndex(i, remap[GetIndex(i)]);
+	palette_ = palette;
+
+	unsigned bits = 1;
+	while ((size_t(1) << bits) < palette_.size())
+		bits *= 2;
+
+	if (bits != bits_)
+		Repack(bits);
+}
+
+bool BlockStorage::IsUniform() const
+{
+	return bits_ == 0;
+}
+
+Block BlockStorage::GetUniform() const
+{
+	return palette_[0];
+}
+
+size_t BlockStorage::Size() const
+{
+	return size_;
+}
+
+size_t BlockStorage::PaletteSize() const
+{
+	return palette_.size();
+}
+
+unsigned BlockStorage::BitsPerEntry() const
+{
+	return bits_;
+}
+
+size_t BlockStorage::MemoryUsage() const
+{
+	return palette_.capacity() * sizeof(Block) + data_.capacity() * sizeof(Word);
+}
+
+unsigned BlockStorage::GetIndex(size_t index) const
+{
+	if (bits_ == 0)
+		return 0;
+
+	// Entries never straddle words since bits is a power of two
+	size_t bit = index * bits_;
+	return unsigned(data_[bit / wordBits] >> (bit % wordBits)) & ((1u << bits_) - 1);
+}
+
+void BlockStorage::SetIndex(size_t index, unsigned value)
+{
+	if (bits_ == 0)
+		return;
+
+	size_t bit = index * bits_;
+	Word mask = Word((1u << bits_) - 1) << (bit % wordBits);
+	Word &word = data_[bit / wordBits];
+	word = (word & ~mask) | (Word(value) << (bit % wordBits));
+}
+
+unsigned BlockStorage::FindOrAdd(Block block)
+{
+	for (unsigned i = 0; i < palette_.size(); i++)
+	{
+		if (palette_[i] == block)
+			return i;
+	}
+
+	palette_.push_back(block);
+
+	// Grow entry size until the palette fits
+	unsigned bits = bits_ == 0 ? 1 : bits_;
+	while ((size_t(1) << bits) < palette_.size())
+		bits *= 2;
+
+	if (bits != bits_)
+		Repack(bits);
+
+	return unsigned(palette_.size() - 1);
+}
+
+void BlockStorage::Repack(unsigned bits)
+{
+	std::vector<Word> oldData;
+	oldData.swap(data_);
+	unsigned oldBits = bits_;
+
+	bits_ = bits;
+	data_.assign((size_ * bits + wordBits - 1) / wordBits, 0);
+
+	// Copy every palette index into the new layout (uniform storage is all zero indices)
+	if (oldBits != 0)
+	{
+		Word oldMask = (Word(1) << oldBits) - 1;
+		for (size_t i = 0; i < size_; i++)
+		{
+			size_t bit = i * oldBits;
+			SetIndex(i, unsigned((oldData[bit / wordBits] >> (bit % wordBits)) & oldMask));
+		}
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "Block.h"
+
+// Palette compressed block array
+//	Each entry is a bit-packed index into a palette of the block types present
+//	Bits per entry grows (0, 1, 2, 4, 8) as new types are added
+class BlockStorage
+{
+public:
+	// Create storage of given size filled with one block
+	BlockStorage(size_t size, Block fill = { Block::BLOCK_AIR });
+
+	// Individual block get/set
+	Block Get(size_t index) const;
+	void Set(size_t index, Block block);
+
+	// Set every entry to one block, releasing packed data
+	void Fill(Block block);
+
+	// Drop unused palette entries and shrink packed data to fit
+	void Compact();
+
+	// Get info
+	bool IsUniform() const; // every entry is the same block, no packed data
+	Block GetUniform() const; // block of a uniform storage
+	size_t Size() const;
+	size_t PaletteSize() const;
+	unsigned BitsPerEntry() const;
+	size_t MemoryUsage() const; // heap bytes used by palette and packed data
+
+private:
+	typedef uint64_t Word;
+	static const unsigned wordBits = sizeof(Word) * 8;
+
+	size_t size_;
+	unsigned bits_; // 0 means every entry is palette_[0]
+	std::vector<Block> palette_;
+	std::vector<Word> data_;
+
+	unsigned GetIndex(size_t index) const; // read packed palette index
+	void SetIndex(size_t index, unsigned value); // write packed palette index
+	unsigned FindOrAdd(Block block); // get palette index of block, adding and repacking if needed
+	void Repack(unsigned bits); // change bits per entry, keeping contents
+};
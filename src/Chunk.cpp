@@ -1,26 +1,61 @@
 #include "Chunk.h"
-#include "ChunkManager.h"
+#include "ChunkMesher.h"
 #include "glm/gtc/noise.hpp"
 #include "glm/gtx/compatibility.hpp"
 
-Chunk::Chunk(glm::ivec2 pos) : position_(pos), mesh_(World::chunkArea * 8), heightTimer_(0.0f), heightTimerIncreasing_(true), highestSolidBlock_(0)
+#include <cassert>
+
+Chunk::Chunk(glm::ivec2 pos) : position_(pos), heightTimer_(0.0f), heightTimerIncreasing_(true), highestSolidBlock_(0), modified_(false), meshTicket_(0), state_(STATE_EMPTY), meshWanted_(false), dependents_(0), jobReferences_(0), sections_(World::sectionCount, BlockStorage(World::sectionVolume))
 {
+	neighbors_.fill(nullptr);
+	neighbors_[4] = this;
+}
+
+void Chunk::Reset(glm::ivec2 pos)
+{
+	position_ = pos;
+	heightTimer_ = 0.0f;
+	heightTimerIncreasing_ = true;
+	highestSolidBlock_ = 0;
+	modified_ = false;
+	meshTicket_++;
+	state_ = STATE_EMPTY;
+	meshWanted_ = false;
+	assert(dependents_ == 0);
+	assert(jobReferences_ == 0);
+
+	for (BlockStorage &section : sections_)
+		section.Fill({ Block::BLOCK_AIR });
+
+	neighbors_.fill(nullptr);
+	neighbors_[4] = this;
+
+	mesh_.Clear();
 }
 
 void Chunk::Generate(TerrainGenerator &gen)
 {
 	glm::ivec3 chunk_pos = GetWorldPos();
 
+	glm::ivec2 chunkPos2d = {
+		chunk_pos.x,
+		chunk_pos.z
+	};
+
+	// Heights of this chunk, reused for the trees rooted in it
+	static thread_local HeightMap heights;
+	gen.GenerateHeightMap(chunkPos2d, glm::ivec2(World::chunkSize, World::chunkSize), heights);
+
 	// Terrain
 
-	// Loop over z and x and generate heights
+	// Loop over z and x and fill up to each height
 	for (int z = 0; z < World::chunkSize; z++)
 	{
 		for (int x = 0; x < World::chunkSize; x++)
 		{
 			// Get the height for this coord
 			glm::ivec2 pos = glm::ivec2(chunk_pos.x + x, chunk_pos.z + z);
-			int height = gen.GetHeight(pos);
+			int height = heights.Get(pos);
 
 			for (int y = 0; y < height; y++)
 			{
@@ -38,165 +73,203 @@ void Chunk::Generate(TerrainGenerator &gen)
 			}
 		}
 	}
-	
-	// Trees
 
-	glm::ivec3 treeSize = {
-		std::size(*TerrainGenerator::tree),
-		std::size(TerrainGenerator::tree),
-		std::size(**TerrainGenerator::tree)
-	};
-	glm::ivec2 treeRad = {
-		(treeSize.x - 1) / 2,
-		(treeSize.z - 1) / 2
-	};
-	glm::ivec2 chunkPos2d = {
-		chunk_pos.x,
-		chunk_pos.z
-	};
 	
-	// Get all points of trees around this chunk
-	std::vector<glm::ivec2> treePoints = gen.GenerateTreePoints(
-		chunkPos2d - treeRad,
-		chunkPos2d + glm::ivec2(World::chunkSize, World::chunkSize) + treeRad
-	);
-
-	// For each tree, loop over all it's blocks and set them
-	for (unsigned i = 0; i < treePoints.size(); i++)
+	// Structures
+
+	// Blocks of structures reaching this chunk, each built once by the chunk it starts in
+	static thread_local std::vector<FeatureBlock> features;
+	gen.GetFeatureBlocks(GetCoord(), heights, features);
+
+	for (const FeatureBlock &feature : features)
 	{
-		for (int y = 0; y < treeSize.y; y++)
-		{
-			for (int x = -treeRad.x; x <= treeRad.x; x++)
-			{
-				for (int z = -treeRad.y; z <= treeRad.y; z++)
-				{
-					// Get block from tree data
-					Block newBlock = { Block::BlockType(TerrainGenerator::tree[y][x + treeRad.x][z + treeRad.y]) };
-
-					if (newBlock.type != Block::BLOCK_AIR)
-					{
-						glm::ivec3 blockPos = {
-							treePoints[i].x + x,
-							gen.GetHeight(treePoints[i]) + y,
-							treePoints[i].y + z
-						};
-
-						const Block &oldBlock = GetBlock(blockPos);
-
-						// Only allow leaves to replace air
-						if (newBlock.type != Block::BLOCK_LEAVES || oldBlock.type == Block::BLOCK_AIR)
-							SetBlock(blockPos, newBlock);
-					}
-				}
-			}
-		}
+		glm::ivec3 blockPos = { feature.x, feature.y, feature.z };
+		if (!feature.onlyAir || GetBlockLocal(blockPos).type == Block::BLOCK_AIR)
+			SetBlockLocal(blockPos, feature.block);
 	}
+
+	// Collapse solid and empty sections
+	for (BlockStorage &section : sections_)
+		section.Compact();
 }
 
-void Chunk::BuildMesh()
+ChunkData Chunk::TakeBlockData()
 {
-	mesh_.Clear();
+	ChunkData data = { std::move(sections_), highestSolidBlock_, modified_ };
+
+	sections_.assign(World::sectionCount, BlockStorage(World::sectionVolume));
+	highestSolidBlock_ = 0;
+	modified_ = false;
+	return data;
+}
+
+void Chunk::RestoreBlockData(ChunkData &&data)
+{
+	sections_ = std::move(data.sections);
+	highestSolidBlock_ = data.highestSolidBlock;
+	modified_ = data.modified;
+}
+
+ChunkData Chunk::CopyBlockData() const
+{
+	return { sections_, highestSolidBlock_, modified_ };
+}
+
+void Chunk::MarkModified()
+{
+	modified_ = true;
+}
+
+void Chunk::ClearModified()
+{
+	modified_ = false;
+}
+
+bool Chunk::IsModified() const
+{
+	return modified_;
+}
+
+void Chunk::BuildMesh(bool greedy)
+{
+	// Gpu uploads only happen on the main thread, so one buffer is reused for every build
+	static ChunkMeshData data;
+
+	data.Clear();
+	BuildMeshData(data, greedy);
+	mesh_.Upload(data);
+	meshTicket_++;
+
+	// Rebuilding a floating out mesh keeps it floating out
+	if (state_ != STATE_UNLOADING)
+		state_ = STATE_UPLOADED;
+}
+
+void Chunk::BuildMeshData(ChunkMeshData &data, bool greedy) const
+{
+	// One snapshot buffer per thread, reused between builds
+	thread_local ChunkMesher mesher;
+
+	mesher.Load(*this);
+	mesher.Build(data, greedy);
+}
+
+unsigned Chunk::QueueMesh()
+{
+	state_ = STATE_MESHING;
+	return ++meshTicket_;
+}
+
+bool Chunk::MeshCurrent(unsigned ticket) const
+{
+	return ticket == meshTicket_;
+}
+
+bool Chunk::FinishMesh(const ChunkMeshData &data, unsigned ticket)
+{
+	if (!MeshCurrent(ticket))
+		return false;
+
+	mesh_.Upload(data);
+	state_ = STATE_UPLOADED;
+	return true;
+}
+
+bool Chunk::MeshQueued() const
+{
+	return state_ == STATE_MESHING || state_ == STATE_MESHED;
+}
+
+Chunk::State Chunk::GetState() const
+{
+	return state_;
+}
+
+void Chunk::SetState(State state)
+{
+	state_ = state;
+}
+
+void Chunk::SetMeshWanted(bool wanted)
+{
+	meshWanted_ = wanted;
+}
 
-	// Loop over all blocks before sky
-	for (int y = 0; y <= highestSolidBlock_; y++)
+bool Chunk::MeshWanted() const
+{
+	return meshWanted_;
+}
+
+void Chunk::AddDependent()
+{
+	dependents_++;
+}
+
+void Chunk::RemoveDependent()
+{
+	assert(dependents_ > 0);
+	dependents_--;
+}
+
+bool Chunk::HasDependents() const
+{
+	return dependents_ != 0;
+}
+
+unsigned Chunk::GetDependentCount() const
+{
+	return dependents_;
+}
+
+bool Chunk::NeighborsLoaded() const
+{
+	for (Chunk *neighbor : neighbors_)
 	{
-		for (int z = 0; z < World::chunkSize; z++)
-		{
-			for (int x = 0; x < World::chunkSize; x++)
-			{
-				const Block &block = GetBlockLocal({ x, y, z });
-				if (block.type == Block::BLOCK_AIR)
-					continue;
-
-				// For each direction
-				for (int d = 0; d < Math::DIRECTION_COUNT; d++)
-				{
-					// Get block in this direction
-					glm::ivec3 adjacent = { x, y, z };
-					glm::vec3 normal = Math::directionVectors[d];
-					adjacent += normal;
-
-					// If block in this direction
-					if (adjacent.y >= 0 && !CheckForBlock(adjacent))
-					{
-						const int tilesheetSize = 8;
-						unsigned index = 0;
-						
-						// Get texture index
-						switch (d)
-						{
-						case Math::DIRECTION_FORWARD:
-						case Math::DIRECTION_BACKWARD:
-						case Math::DIRECTION_LEFT:
-						case Math::DIRECTION_RIGHT:
-							index = BlockData::sideIndicies[block.type].side;
-							break;
-						case Math::DIRECTION_UP:
-							index = BlockData::sideIndicies[block.type].top;
-							break;
-						case Math::DIRECTION_DOWN:
-							index = BlockData::sideIndicies[block.type].bottom;
-							break;
-						}
-
-						// Get texture coords
-						glm::vec2 offset = Math::GetUVFromSheet(tilesheetSize, tilesheetSize, index, Math::CORNER_TOP_LEFT);
-						offset.y = 1.0f - offset.y - (1.0f / tilesheetSize); // flip texture
-
-						unsigned char ambient[Math::CORNER_COUNT];
-
-						// Generate ambient occlusion vertices
-						for (int i = 0; i < Math::CORNER_COUNT; i++)
-						{
-							// Get block touching this corner
-							glm::ivec3 dir = Math::CornerToVec(Math::Corner(i), Math::Direction(d));
-							glm::ivec3 corner = adjacent + dir;
-							glm::ivec3 sides[2];
-
-							// Get adjacent blocks touching this block
-							unsigned current = 0;
-							for (int j = 0; j < dir.length(); j++)
-							{
-								if (dir[j] == 0)
-									continue;
-
-								// For each dimension, set one to zero
-								sides[current] = dir;
-								sides[current][j] = 0;
-								sides[current] += adjacent;
-								current++;
-							}
-							bool cornerExists = CheckForBlock(corner);
-							bool side0Exists = CheckForBlock(sides[0]);
-							bool side1Exists = CheckForBlock(sides[1]);
-
-							if (side0Exists && side1Exists)
-								ambient[i] = 0; // max darkness
-							else
-								ambient[i] = 3 - (int(side0Exists) + int(side1Exists) + int(cornerExists)); // darkness depends on which sides exist
-						}
-
-						mesh_.AddQuad(
-							Math::Direction(d),
-							glm::vec3(x + 0.5f, y + 0.5f, z + 0.5f) + normal * 0.5f, 1.0f / tilesheetSize, offset, ambient
-						);
-					}
-				}
-			}
-		}
+		if (neighbor == nullptr)
+			return false;
 	}
-	mesh_.TransferToGPU();
+
+	return true;
+}
+
+void Chunk::AddJobReference()
+{
+	jobReferences_++;
+}
+
+void Chunk::RemoveJobReference()
+{
+	assert(jobReferences_ > 0);
+	jobReferences_--;
+}
+
+bool Chunk::HasJobReferences() const
+{
+	return jobReferences_ != 0;
+}
+
+std::shared_mutex &Chunk::GetMutex() const
+{
+	return mutex_;
 }
 
 void Chunk::ClearMesh()
 {
 	mesh_.Clear();
+	meshTicket_++;
 	heightTimer_ = 0.0f;
+	heightTimerIncreasing_ = true;
+	state_ = NeighborsLoaded() ? STATE_NEIGHBORS_READY : STATE_GENERATED;
 }
 
 bool Chunk::MeshBuilt() const
 {
-	return mesh_.IndexCount() != 0;
+	return state_ == STATE_UPLOADED || state_ == STATE_UNLOADING;
+}
+
+unsigned Chunk::GetTriangleCount() const
+{
+	return mesh_.IndexCount() / 3;
 }
 
 void Chunk::SetBlock(glm::ivec3 pos, const Block &block)
@@ -207,15 +280,13 @@ void Chunk::SetBlock(glm::ivec3 pos, const Block &block)
 		SetBlockLocal(local, block);
 }
 
-const Block &Chunk::GetBlock(glm::ivec3 pos) const
+Block Chunk::GetBlock(glm::ivec3 pos) const
 {
 	glm::ivec3 local = WorldToLocal(pos);
 
 	if (OutOfBounds(local))
-	{
-		static Block error = { Block::BLOCK_ERROR };
-		return error;
-	}
+		return { Block::BLOCK_ERROR };
+
 	return GetBlockLocal(local);
 }
 
@@ -260,6 +331,39 @@ bool Chunk::HeightTimerHitZero() const
 	return heightTimer_ == 0.0f && !heightTimerIncreasing_;
 }
 
+size_t Chunk::GetMemoryUsage() const
+{
+	size_t total = sizeof(*this) + sections_.capacity() * sizeof(BlockStorage);
+	for (const BlockStorage &section : sections_)
+		total += section.MemoryUsage();
+	return total;
+}
+
+size_t Chunk::GetMeshMemoryUsage() const
+{
+	return mesh_.GetMemoryUsage();
+}
+
+int Chunk::GetHighestBlock() const
+{
+	return highestSolidBlock_;
+}
+
+const BlockStorage &Chunk::GetSection(unsigned section) const
+{
+	return sections_[section];
+}
+
+Chunk *Chunk::GetNeighbor(glm::ivec2 offset) const
+{
+	return neighbors_[(offset.x + 1) + (offset.y + 1) * 3];
+}
+
+void Chunk::SetNeighbor(glm::ivec2 offset, Chunk *neighbor)
+{
+	neighbors_[(offset.x + 1) + (offset.y + 1) * 3] = neighbor;
+}
+
 bool Chunk::IsVisible(const Math::Frustum &camera) const
 {
 	glm::vec3 position = GetRenderPos();
@@ -305,36 +409,16 @@ bool Chunk::OutOfBounds(glm::ivec3 pos) const
 	return pos.x < 0 || pos.x >= World::chunkSize || pos.y < 0 || pos.y >= World::chunkHeight || pos.z < 0 || pos.z >= World::chunkSize;
 }
 
-const Block &Chunk::GetBlockLocal(glm::ivec3 pos) const
+Block Chunk::GetBlockLocal(glm::ivec3 pos) const
 {
-	return blocks_[pos.x + pos.y * World::chunkArea + pos.z * World::chunkSize];
+	return sections_[pos.y / World::sectionHeight].Get(pos.x + (pos.y % World::sectionHeight) * World::chunkArea + pos.z * World::chunkSize);
 }
 
 void Chunk::SetBlockLocal(glm::ivec3 pos, const Block &block)
 {
-	blocks_[pos.x + pos.y * World::chunkArea + pos.z * World::chunkSize] = block;
+	sections_[pos.y / World::sectionHeight].Set(pos.x + (pos.y % World::sectionHeight) * World::chunkArea + pos.z * World::chunkSize, block);
 
 	// This operation might change the highest block
 	if (pos.y > highestSolidBlock_)
 		highestSolidBlock_ = pos.y;
-}
-
-bool Chunk::CheckForBlock(glm::ivec3 pos) const
-{
-	if (!OutOfBounds(pos))
-		return GetBlockLocal(pos).type != Block::BLOCK_AIR;
-	else
-	{
-		// Block above/below height limits
-		if (pos.y < 0 || pos.y >= World::chunkHeight)
-			return false;
-
-		// Block in another chunk
-		glm::ivec3 world = LocalToWorld(pos);
-		Block block = ChunkManager::Instance().GetBlock(world);
-
-		assert(block.type != Block::BLOCK_ERROR);
-
-		return block.type != Block::BLOCK_AIR;
-	}
-}
+}
\ No newline at end of file
@@ -1,35 +1,99 @@
 #pragma once
 
 #include <array>
+#include <vector>
+#include <shared_mutex>
 
 #include <glm/glm.hpp>
 
-#include "Mesh.h"
+#include "ChunkMesh.h"
 #include "WorldConstants.h"
 #include "Block.h"
+#include "BlockStorage.h"
+#include "ChunkData.h"
 #include "TerrainGenerator.h"
 
 // Collection of blocks, world is made of a 2d grid of chunks
 class Chunk
 {
 public:
+	// Lifecycle stages, changed by the chunk manager as loading events happen
+	enum State
+	{
+		STATE_EMPTY, // no block data, being generated
+		STATE_GENERATED, // block data ready, some surrounding chunks aren't
+		STATE_NEIGHBORS_READY, // this and all surrounding chunks generated, a mesh can be built
+		STATE_MESHING, // mesh being built in the background
+		STATE_MESHED, // mesh built, waiting for upload
+		STATE_UPLOADED, // mesh drawn
+		STATE_UNLOADING, // mesh drawn while floating out, cleared when down
+	};
+
 	Chunk(glm::ivec2 pos);
 
+	// Clear all state for reuse at a new coord, keeping gpu objects
+	void Reset(glm::ivec2 pos);
+
 	// Generate block data
 	void Generate(TerrainGenerator &gen);
 
-	// Generate mesh from block data
-	void BuildMesh();
+	// Move block data out, leaving the chunk empty; or replace it instead of generating
+	ChunkData TakeBlockData();
+	void RestoreBlockData(ChunkData &&data);
+	ChunkData CopyBlockData() const; // for saving while the chunk stays loaded
+
+	// Blocks were edited since generating, loading, or saving
+	void MarkModified();
+	void ClearModified();
+	bool IsModified() const;
+
+	// Generate mesh from block data, greedy merges faces into larger quads
+	void BuildMesh(bool greedy = false);
+
+	// Build mesh quads without uploading them, safe on worker threads while neighbors are loaded
+	void BuildMeshData(ChunkMeshData &data, bool greedy) const;
+
+	// Asynchronous meshing, main thread only
+	unsigned QueueMesh(); // mark a mesh as being built elsewhere, returns its ticket
+	bool MeshCurrent(unsigned ticket) const; // if a queued mesh is still wanted
+	bool FinishMesh(const ChunkMeshData &data, unsigned ticket); // upload a queued mesh unless the mesh changed since, returns if uploaded
+	bool MeshQueued() const;
+
+	// Lifecycle state, main thread only
+	State GetState() const;
+	void SetState(State state);
+
+	// If the chunk manager wants this chunk meshed, it depends on itself and all surrounding chunks while it does
+	void SetMeshWanted(bool wanted);
+	bool MeshWanted() const;
+
+	// Count of chunks whose mesh needs this chunk's blocks, main thread only; it stays loaded while any do
+	void AddDependent();
+	void RemoveDependent();
+	bool HasDependents() const;
+	unsigned GetDependentCount() const;
 
-	// Remove chunk's mesh
+	// Are this and all surrounding chunks linked?
+	bool NeighborsLoaded() const;
+
+	// Count of jobs reading this chunk, main thread only; it can't be released while any are running
+	void AddJobReference();
+	void RemoveJobReference();
+	bool HasJobReferences() const;
+
+	// Held shared while other threads read blocks, unique while the main thread writes them
+	std::shared_mutex &GetMutex() const;
+
+	// Remove chunk's mesh, going back to a generated state
 	void ClearMesh();
 
 	// Does this chunk have a mesh?
 	bool MeshBuilt() const;
+	unsigned GetTriangleCount() const;
 
 	// Individual block get/set
 	void SetBlock(glm::ivec3 pos, const Block &block);
-	const Block &GetBlock(glm::ivec3 pos) const;
+	Block GetBlock(glm::ivec3 pos) const;
 
 	// Position getters
 	glm::ivec2 GetCoord() const; // chunk coords
@@ -41,6 +105,22 @@ public:
 	void SetHeightTimerIncreasing(bool increasing);
 	bool HeightTimerHitZero() const;
 
+	// Bytes used by this chunk's block data
+	size_t GetMemoryUsage() const;
+
+	// Bytes of gpu memory used by this chunk's mesh
+	size_t GetMeshMemoryUsage() const;
+
+	// Highest local y that has ever held a block
+	int GetHighestBlock() const;
+
+	// Block data of one vertical section
+	const BlockStorage &GetSection(unsigned section) const;
+
+	// Loaded chunk at a chunk coord offset in [-1, 1], nullptr if not loaded
+	Chunk *GetNeighbor(glm::ivec2 offset) const;
+	void SetNeighbor(glm::ivec2 offset, Chunk *neighbor);
+
 	// Is this chunk inside a frustum?
 	bool IsVisible(const Math::Frustum &camera) const;
 
@@ -49,20 +129,29 @@ public:
 
 private:
 	glm::ivec2 position_;
-	Mesh mesh_;
+	ChunkMesh mesh_;
 	float heightTimer_; // 0: down, 1: up
 	bool heightTimerIncreasing_;
 	int highestSolidBlock_; // Currently stores highest ever existed
+	bool modified_;
+	unsigned meshTicket_; // changes whenever the mesh does, so older queued meshes are dropped
+	State state_;
+	bool meshWanted_;
+	unsigned dependents_;
+	unsigned jobReferences_;
+	mutable std::shared_mutex mutex_;
 	
-	// low to high: x, z, y
-	std::array<Block, World::chunkSize * World::chunkSize * World::chunkHeight> blocks_ = {};
+	// Sections low to high, each low to high: x, z, y
+	std::vector<BlockStorage> sections_;
+
+	// 3x3 grid of surrounding chunks, low to high: x, z; center is this chunk
+	std::array<Chunk *, 9> neighbors_;
 
 	glm::ivec3 WorldToLocal(glm::ivec3 pos) const; // world block coord to local block coord
 	glm::ivec3 LocalToWorld(glm::ivec3 pos) const; // local block coord to world block coord
 	bool OutOfBounds(glm::ivec3 pos) const; // is this local block coord invalid?
-	const Block &GetBlockLocal(glm::ivec3 pos) const; // get the block at a local coord
+	Block GetBlockLocal(glm::ivec3 pos) const; // get the block at a local coord
 	void SetBlockLocal(glm::ivec3 pos, const Block &block); // set the block at a local coord
-	bool CheckForBlock(glm::ivec3 pos) const; // is a solid block at coord?
 
 };
 
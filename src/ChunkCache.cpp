@@ -0,0 +1,86 @@
+#include "ChunkCache.h"
+
+ChunkCache::ChunkCache(size_t capacity, bool compact) : capacity_(capacity), compact_(compact)
+{
+}
+
+void ChunkCache::Store(glm::ivec2 coord, ChunkData &&data)
+{
+	auto existing = index_.find(coord);
+	if (existing != index_.end())
+		Erase(existing->second);
+
+	if (compact_)
+	{
+		for (BlockStorage &section : data.sections)
+			section.Compact();
+	}
+
+	size_t bytes = sizeof(Entry) + data.sections.capacity() * sizeof(BlockStorage);
+	for (const BlockStorage &section : data.sections)
+		bytes += section.MemoryUsage();
+
+	entries_.push_front({ coord, std::move(data), bytes });
+	index_[coord] = entries_.begin();
+	stats_.entries++;
+	stats_.bytes += bytes;
+
+	// Always keep the newest even if it's bigger than the capacity alone
+	Evict(1);
+}
+
+bool ChunkCache::Take(glm::ivec2 coord, ChunkData &data)
+{
+	auto found = index_.find(coord);
+	if (found == index_.end())
+	{
+		stats_.misses++;
+		return false;
+	}
+
+	data = std::move(found->second->data);
+	Erase(found->second);
+	stats_.hits++;
+	return true;
+}
+
+void ChunkCache::Clear()
+{
+	entries_.clear();
+	index_.clear();
+	stats_.entries = 0;
+	stats_.bytes = 0;
+}
+
+void ChunkCache::SetCapacity(size_t capacity)
+{
+	capacity_ = capacity;
+	Evict(0);
+}
+
+const ChunkCache::Stats &ChunkCache::GetStats() const
+{
+	return stats_;
+}
+
+size_t ChunkCache::GetCapacity() const
+{
+	return capacity_;
+}
+
+void ChunkCache::Erase(std::list<Entry>::iterator entry)
+{
+	stats_.entries--;
+	stats_.bytes -= entry->bytes;
+	index_.erase(entry->coord);
+	entries_.erase(entry);
+}
+
+void ChunkCache::Evict(size_t keep)
+{
+	while (stats_.bytes > capacity_ && entries_.size() > keep)
+	{
+		Erase(std::prev(entries_.end()));
+		stats_.evictions++;
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <list>
+#include <unordered_map>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+
+#include "ChunkData.h"
+
+// Block data of recently unloaded chunks, so coming back restores them instead of generating again
+//	Least recently stored chunks are evicted once the cache is over its byte capacity
+class ChunkCache
+{
+public:
+	// Usage counters
+	struct Stats
+	{
+		size_t hits = 0; // loads restored from the cache
+		size_t misses = 0; // loads that had to generate
+		size_t evictions = 0; // chunks dropped for room
+		size_t entries = 0;
+		size_t bytes = 0;
+	};
+
+	// Compact stores palettes with only the blocks still used, smaller but slower to store
+	ChunkCache(size_t capacity, bool compact);
+
+	// Keep a chunk's block data, replacing any older data at the coord
+	void Store(glm::ivec2 coord, ChunkData &&data);
+
+	// Move cached data out if there is any, counting a hit or miss
+	bool Take(glm::ivec2 coord, ChunkData &data);
+
+	// Drop all cached data
+	void Clear();
+
+	// Change the byte capacity, evicting oldest chunks to fit
+	void SetCapacity(size_t capacity);
+
+	// Get info
+	const Stats &GetStats() const;
+	size_t GetCapacity() const;
+
+private:
+	struct Entry
+	{
+		glm::ivec2 coord;
+		ChunkData data;
+		size_t bytes;
+	};
+
+	size_t capacity_;
+	bool compact_;
+	std::list<Entry> entries_; // most recent first
+	std::unordered_map<glm::ivec2, std::list<Entry>::iterator> index_;
+	Stats stats_;
+
+	void Erase(std::list<Entry>::iterator entry);
+	void Evict(size_t keep); // evict oldest while over capacity, leaving at least keep entries
+};
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <vector>
+
+#include "BlockStorage.h"
+
+// Block data of a chunk without its position, moved between chunks, the unload cache, and region files
+struct ChunkData
+{
+	std::vector<BlockStorage> sections; // low to high
+	int highestSolidBlock;
+	bool modified; // edited since generating or loading, so it needs saving
+};
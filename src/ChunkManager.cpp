@@ -11,166 +11,699 @@
 #include <glm/gtx/norm.hpp>
 
 #include <iostream>
+#include <algorithm>
 
-ChunkManager::ChunkManager() : shader_("shaders/shader.vert", "shaders/shader.frag"), texture_("resources/tileset.png", true, true, GL_REPEAT, GL_NEAREST)
+// In range load queue entries checked per frame, starting at the first unmeshed one
+static const size_t loadScanCount = 64;
+
+// Player movement farther than this in one frame is a teleport, not velocity
+static const float teleportDistance = 4.0f * World::chunkSize;
+
+// Weight of each frame's movement in the smoothed velocity
+static const float velocitySmoothing = 0.1f;
+
+// Prefetch jobs count as this much farther than any chunk the load queue wants
+static const float prefetchPriority = 2.0f * World::unloadDistance;
+
+// Seconds between checking memory against the caps
+static const float memoryCheckInterval = 1.0f;
+
+// Load queue is sorted again when the view turns more than this from the direction it was sorted with
+static const float loadResortCos = 0.7f;
+
+// Enough chunks to cover the unload square plus its ring of unmeshed neighbors
+static size_t PoolCapacity()
+{
+	size_t diameter = 2 * (size_t(World::unloadDistance / World::chunkSize) + 2) + 1;
+	return diameter * diameter;
+}
+
+ChunkManager::ChunkManager() :
+	shader_("shaders/shader.vert", "shaders/shader.frag"),
+	texture_("resources/tileset.png", true, true, GL_REPEAT, GL_NEAREST),
+	chunks_(PoolCapacity()),
+	pool_(PoolCapacity()),
+	cache_(World::chunkCacheSize, World::chunkCacheCompact),
+	log_(World::saveEditJournal ? nullptr : std::make_unique<WriteAheadLog>(World::saveDirectory, "edits.wal")),
+	storage_(World::saveDirectory),
+	journal_(World::saveDirectory, "edits.log"),
+	greedyMeshing_(false),
+	generating_(PoolCapacity()),
+	playerPos_(0.0f),
+	viewDir_(0.0f),
+	loadCursor_(0),
+	loadCenter_(0),
+	loadView_(0.0f),
+	prefetched_(World::prefetchLimit),
+	velocity_(0.0f),
+	prefetchCenter_(0),
+	prefetchCursor_(0),
+	renderDistance_(World::renderDistance),
+	unloadDistance_(World::unloadDistance),
+	chunkMemoryCap_(World::chunkMemoryCap),
+	meshMemoryCap_(World::meshMemoryCap),
+	memoryTimer_(0.0f),
+	memoryStats_(),
+	checkpointTimer_(0.0f),
+	scheduler_(World::chunkFrameBudget, World::chunkQueueTime)
 {
 	// Default uniform variables
 	shader_.SetVar("tex", 0);
 	shader_.SetVar("fogAmount", 0.7f / World::renderDistance);
+
+	// Logged edits are safe to drop once their chunk is on disk
+	if (log_)
+	{
+		storage_.SetSavedCallback([this](glm::ivec2 coord, uint64_t sequence) { log_->Checkpoint(coord, sequence); });
+		RecoverEdits();
+	}
 }
 
 ChunkManager::~ChunkManager()
 {
-	for (const auto &c : chunks_)
-		delete c.second;
+	// Wait for jobs before releasing anything they use
+	workers_.Stop();
+
+	// Pending generated chunks are still in generating_
+	for (Chunk *chunk : generating_)
+		pool_.Release(chunk);
+
+	// Edited chunks are saved, storage writes them all before it's destroyed
+	for (Chunk *chunk : chunks_)
+	{
+		if (chunk->IsModified())
+			storage_.Save(chunk->GetCoord(), chunk->TakeBlockData(), GetLogSequence(chunk->GetCoord()));
+		pool_.Release(chunk);
+	}
+
+	// No mesh draws again
+	ChunkMesh::ReleaseShared();
 }
 
-Chunk *ChunkManager::AddChunk(glm::ivec2 coord)
+void ChunkManager::QueueChunk(glm::ivec2 coord)
 {
-	Chunk *currentChunk = GetChunk(coord);
-	if (currentChunk == nullptr)
+	Chunk *chunk = LoadChunk(coord);
+	if (chunk->MeshWanted())
+		return;
+
+	// Keep this chunk and everything its mesh reads loaded until the mesh is released
+	chunk->SetMeshWanted(true);
+	for (int z = -1; z <= 1; z++)
 	{
-		// Generate this chunk
-		currentChunk = new Chunk(coord);
-		currentChunk->Generate(noise_);
-		chunks_[coord] = currentChunk;
+		for (int x = -1; x <= 1; x++)
+			LoadChunk(coord + glm::ivec2(x, z))->AddDependent();
 	}
-	else if (currentChunk->MeshBuilt())
+
+	// Otherwise it's queued when the last surrounding chunk is added
+	if (chunk->GetState() == Chunk::STATE_NEIGHBORS_READY)
+		QueueMesh(chunk);
+}
+
+void ChunkManager::ReleaseMesh(Chunk *chunk)
+{
+	glm::ivec2 coord = chunk->GetCoord();
+
+	// Queued meshes are dropped when they come back
+	chunk->SetMeshWanted(false);
+	chunk->ClearMesh();
+
+	// Player may want it again without changing chunks, look over the whole load queue again
+	loadCursor_ = 0;
+
+	std::array<Chunk *, 9> sources;
+	for (int z = -1; z <= 1; z++)
 	{
-		// Chunk already exists
-		return currentChunk;
+		for (int x = -1; x <= 1; x++)
+		{
+			Chunk *source = FindChunk(coord + glm::ivec2(x, z));
+			source->RemoveDependent();
+			sources[(x + 1) + (z + 1) * 3] = source;
+		}
 	}
 
-	// Generate surrounding chunks and add
-	for (unsigned i = 0; i < std::size(Math::surrounding); i++)
+	for (Chunk *source : sources)
+		TryRemoveChunk(source);
+}
+
+Chunk *ChunkManager::LoadChunk(glm::ivec2 coord, bool prefetch)
+{
+	Chunk *chunk = FindChunk(coord);
+	if (chunk != nullptr)
+		return chunk;
+
+	chunk = pool_.Acquire(coord);
+
+	// Recently unloaded chunks come back as they were
+	ChunkData data;
+	if (cache_.Take(coord, data))
+	{
+		chunk->RestoreBlockData(std::move(data));
+		InsertChunk(chunk);
+		return chunk;
+	}
+
+	generating_.Insert(coord, chunk);
+
+	// Nothing else sees the chunk until it's finished
+	float priority = JobPriority(coord) + (prefetch ? prefetchPriority : 0.0f);
+	workers_.Submit(priority, [this, chunk]()
 	{
-		glm::ivec2 newCoord = coord + Math::surrounding[i];
-		if (GetChunk(newCoord) == nullptr)
+		double start = glfwGetTime();
+
+		ChunkData saved;
+		if (storage_.Load(chunk->GetCoord(), saved))
+			chunk->RestoreBlockData(std::move(saved));
+		else
+			chunk->Generate(noise_);
+
+		// Journaled edits are replayed over saved chunks too, they may be newer than the region file
+		std::vector<EditJournal::Edit> edits;
+		if (journal_.GetEdits(chunk->GetCoord(), edits))
 		{
-			Chunk *newChunk = new Chunk(newCoord);
-			newChunk->Generate(noise_);
-			chunks_[newCoord] = newChunk;
+			glm::ivec3 origin = chunk->GetWorldPos();
+			for (const EditJournal::Edit &edit : edits)
+				chunk->SetBlock(origin + edit.local, edit.block);
 		}
+		GenerateResult result = { chunk, float(glfwGetTime() - start) };
+
+		std::lock_guard<std::mutex> lock(resultsMutex_);
+		generated_.push_back(result);
+	});
+
+	return chunk;
+}
+
+uint64_t ChunkManager::GetLogSequence(glm::ivec2 coord) const
+{
+	return log_ ? log_->GetSequence(coord) : 0;
+}
+
+void ChunkManager::RecoverEdits()
+{
+	std::vector<WriteAheadLog::Edit> edits;
+	for (glm::ivec2 coord : log_->GetRecoveredChunks())
+	{
+		Chunk *chunk = pool_.Acquire(coord);
+
+		// Applied over whatever the last checkpoint saved
+		ChunkData saved;
+		if (storage_.Load(coord, saved))
+			chunk->RestoreBlockData(std::move(saved));
+		else
+			chunk->Generate(noise_);
+
+		log_->GetRecovered(coord, edits);
+		glm::ivec3 origin = chunk->GetWorldPos();
+		for (const WriteAheadLog::Edit &edit : edits)
+			chunk->SetBlock(origin + edit.local, edit.block);
+
+		// Loads see the queued save, and the log is checkpointed once it's written
+		storage_.Save(coord, chunk->TakeBlockData(), log_->GetSequence(coord));
+		pool_.Release(chunk);
 	}
+}
 
-	// Build this chunk's mesh
-	currentChunk->BuildMesh();
-	return currentChunk;
+Chunk *ChunkManager::FindChunk(glm::ivec2 coord) const
+{
+	Chunk *chunk = chunks_.Find(coord);
+	return chunk != nullptr ? chunk : generating_.Find(coord);
 }
 
-bool ChunkManager::ChunkInRange(glm::vec3 playerPos, glm::vec3 chunkPos) const
+void ChunkManager::QueueMesh(Chunk *chunk)
 {
-	// Check if chunk is closer to player than render distance
-	glm::vec3 pos = chunkPos + glm::vec3(World::chunkSize, 0.0f, World::chunkSize) / 2.f;
-	float distanceSquared = glm::distance2(glm::vec2(pos.x, pos.z), glm::vec2(playerPos.x, playerPos.z));
-	return distanceSquared <= World::renderDistance * World::renderDistance;
+	// Keep the chunk and everything it reads loaded until the result is back
+	std::array<Chunk *, 9> sources;
+	for (int z = -1; z <= 1; z++)
+	{
+		for (int x = -1; x <= 1; x++)
+		{
+			Chunk *source = chunk->GetNeighbor({ x, z });
+			source->AddJobReference();
+			sources[(x + 1) + (z + 1) * 3] = source;
+		}
+	}
+
+	unsigned ticket = chunk->QueueMesh();
+	bool greedy = greedyMeshing_;
+	workers_.Submit(JobPriority(chunk->GetCoord()), [this, chunk, ticket, sources, greedy]()
+	{
+		MeshResult result = { chunk, ticket, sources };
+		double start = glfwGetTime();
+		chunk->BuildMeshData(result.data, greedy);
+		result.seconds = float(glfwGetTime() - start);
+
+		std::lock_guard<std::mutex> lock(resultsMutex_);
+		meshed_.push_back(std::move(result));
+	});
 }
 
-int ChunkManager::BuiltNeighborCount(glm::ivec2 coord, glm::ivec2 exclude) const
+void ChunkManager::ProcessResults()
 {
-	unsigned count = 0;
-	
-	// Loop over surrounding chunks
-	for (unsigned j = 0; j < std::size(Math::surrounding); j++)
 	{
-		glm::ivec2 currentCoord = coord + Math::surrounding[j];
+		std::lock_guard<std::mutex> lock(resultsMutex_);
+		pendingGenerated_.insert(pendingGenerated_.end(), generated_.begin(), generated_.end());
+		std::move(meshed_.begin(), meshed_.end(), std::back_inserter(pendingMeshed_));
+		generated_.clear();
+		meshed_.clear();
+	}
+
+	// Built meshes still wanted wait for upload
+	for (MeshResult &result : pendingMeshed_)
+	{
+		if (result.chunk->GetState() == Chunk::STATE_MESHING && result.chunk->MeshCurrent(result.ticket))
+			result.chunk->SetState(Chunk::STATE_MESHED);
+	}
 
-		if (currentCoord == exclude)
+	// Add generated chunks, unless every chunk that needed them was released while generating
+	size_t added = 0;
+	for (; added < pendingGenerated_.size() && scheduler_.CanRun(ChunkScheduler::OPERATION_INSERT); added++)
+	{
+		const GenerateResult &result = pendingGenerated_[added];
+		scheduler_.Record(ChunkScheduler::OPERATION_GENERATE, result.seconds);
+
+		double start = glfwGetTime();
+		generating_.Erase(result.chunk->GetCoord());
+
+		if (!result.chunk->HasDependents())
+			ReleaseChunk(result.chunk);
+		else
+			InsertChunk(result.chunk);
+
+		scheduler_.Record(ChunkScheduler::OPERATION_INSERT, float(glfwGetTime() - start));
+	}
+	pendingGenerated_.erase(pendingGenerated_.begin(), pendingGenerated_.begin() + added);
+
+	// Upload meshes, stale ones are dropped by the chunk
+	size_t uploaded = 0;
+	for (; uploaded < pendingMeshed_.size() && scheduler_.CanRun(ChunkScheduler::OPERATION_UPLOAD); uploaded++)
+	{
+		MeshResult &result = pendingMeshed_[uploaded];
+		scheduler_.Record(ChunkScheduler::OPERATION_MESH, result.seconds);
+
+		double start = glfwGetTime();
+		result.chunk->FinishMesh(result.data, result.ticket);
+
+		for (Chunk *source : result.sources)
+		{
+			source->RemoveJobReference();
+			TryRemoveChunk(source);
+		}
+
+		scheduler_.Record(ChunkScheduler::OPERATION_UPLOAD, float(glfwGetTime() - start));
+	}
+	pendingMeshed_.erase(pendingMeshed_.begin(), pendingMeshed_.begin() + uploaded);
+
+	// Whatever is left keeps its chunks queued and referenced until a later frame
+	scheduler_.Defer(pendingGenerated_.size() + pendingMeshed_.size());
+}
+
+float ChunkManager::JobPriority(glm::ivec2 coord) const
+{
+	glm::vec2 center = (glm::vec2(coord) + 0.5f) * float(World::chunkSize);
+	glm::vec2 offset = center - glm::vec2(playerPos_.x, playerPos_.z);
+	float distance = glm::length(offset);
+
+	// Chunks behind the player count as up to twice as far
+	glm::vec2 view = glm::vec2(viewDir_.x, viewDir_.z);
+	float facing = 0.0f;
+	if (distance > 0.0f && glm::length2(view) > 0.0f)
+		facing = glm::dot(offset / distance, glm::normalize(view));
+
+	return distance * (1.5f - 0.5f * facing);
+}
+
+void ChunkManager::UpdateLoadQueue()
+{
+	glm::ivec2 center = ToChunkPosition(glm::floor(playerPos_));
+	glm::vec2 view = glm::vec2(viewDir_.x, viewDir_.z);
+	if (glm::length2(view) > 0.0f)
+		view = glm::normalize(view);
+	else
+		view = loadView_;
+
+	bool moved = center != loadCenter_ || loadQueue_.empty();
+	bool turned = glm::dot(view, loadView_) < loadResortCos;
+	if (!moved && !turned)
+		return;
+
+	loadCenter_ = center;
+	loadView_ = view;
+	loadCursor_ = 0;
+
+	// Priorities are relative to the player, so moving needs the whole ring set again
+	const std::vector<glm::ivec2> &offsets = GetLoadOffsets();
+	loadQueue_.resize(offsets.size());
+	for (size_t i = 0; i < offsets.size(); i++)
+	{
+		glm::ivec2 coord = center + offsets[i];
+		loadQueue_[i] = { coord, JobPriority(coord) };
+	}
+
+	std::stable_sort(loadQueue_.begin(), loadQueue_.end(), [](const LoadEntry &lhs, const LoadEntry &rhs)
+	{
+		return lhs.priority < rhs.priority;
+	});
+}
+
+void ChunkManager::UpdateMemory(float dt, size_t chunkBytes, size_t meshBytes)
+{
+	// Cache gets whatever block data room the loaded chunks leave
+	size_t cacheRoom = chunkBytes < chunkMemoryCap_ ? chunkMemoryCap_ - chunkBytes : 0;
+	cache_.SetCapacity(std::min(World::chunkCacheSize, cacheRoom));
+
+	memoryStats_ = { chunkBytes, cache_.GetStats().bytes, meshBytes, chunkMemoryCap_, meshMemoryCap_, renderDistance_ };
+
+	memoryTimer_ += dt;
+	if (memoryTimer_ < memoryCheckInterval)
+		return;
+	memoryTimer_ = 0.0f;
+
+	// Usage grows with the loaded area, only grow back if the larger area should still fit
+	float grown = glm::min(renderDistance_ + World::chunkSize, World::renderDistance);
+	float scale = (grown * grown) / (renderDistance_ * renderDistance_);
+
+	if (chunkBytes > chunkMemoryCap_ || meshBytes > meshMemoryCap_)
+		SetRenderDistance(glm::max(renderDistance_ - World::chunkSize, World::minRenderDistance));
+	else if (chunkBytes * scale < chunkMemoryCap_ && meshBytes * scale < meshMemoryCap_)
+		SetRenderDistance(grown);
+}
+
+void ChunkManager::UpdateCheckpoint(float dt)
+{
+	if (World::saveEditJournal)
+		return;
+
+	checkpointTimer_ += dt;
+	if (checkpointTimer_ < World::checkpointInterval)
+		return;
+	checkpointTimer_ = 0.0f;
+
+	// Copies are written in the background, each one truncates the log once its chunk is on disk
+	for (Chunk *chunk : chunks_)
+	{
+		if (!chunk->IsModified())
 			continue;
 
-		// Count chunk if it's built
-		const Chunk *currentChunk = GetChunk(currentCoord);
-		if (currentChunk != nullptr && currentChunk->MeshBuilt())
-			count++;
+		storage_.Save(chunk->GetCoord(), chunk->CopyBlockData(), GetLogSequence(chunk->GetCoord()));
+		chunk->ClearModified();
 	}
-	return count;
 }
 
-int ChunkManager::BuiltNeighborCount(glm::ivec2 coord) const
+void ChunkManager::SetRenderDistance(float distance)
 {
-	return BuiltNeighborCount(coord, coord);
+	if (distance == renderDistance_)
+		return;
+
+	// Chunks past the new distance float out through the usual unloading
+	renderDistance_ = distance;
+	unloadDistance_ = distance + (World::unloadDistance - World::renderDistance);
+	loadCursor_ = 0;
+	shader_.SetVar("fogAmount", 0.7f / renderDistance_);
 }
 
-void ChunkManager::UpdateChunks(glm::vec3 playerPos, float dt)
+void ChunkManager::UpdatePrefetch(size_t maxQueued)
 {
-	unsigned loadedChunks = 0;
+	glm::vec3 predicted = playerPos_ + velocity_ * World::prefetchTime;
 
-	// Create initial chunks 
-	glm::ivec2 playerChunkCoord = ToChunkPosition(glm::floor(playerPos));
-	Chunk *playerChunk = GetChunk(playerChunkCoord);
-	if (playerChunk == nullptr || !playerChunk->MeshBuilt())
+	// Drop prefetched chunks once something else needs them or the player is no longer heading for them
+	size_t index = 0;
+	while (index < prefetched_.Size())
 	{
-		// Create 3x3 cross shape of chunks on player
-		loadedChunks++;
-		AddChunk(playerChunkCoord);
-		for (int i = 0; i < Math::DIRECTION_COUNT; i++)
+		Chunk *chunk = prefetched_.At(index);
+		glm::ivec2 coord = prefetched_.CoordAt(index);
+		glm::vec3 chunkPos = glm::vec3(coord.x, 0, coord.y) * float(World::chunkSize);
+
+		bool hit = chunk->MeshWanted() || chunk->GetDependentCount() > 1;
+		bool missed = !ChunkInRange(predicted, chunkPos, renderDistance_) && !ChunkInRange(playerPos_, chunkPos, renderDistance_);
+		if (hit || missed)
 		{
-			if (i == Math::DIRECTION_UP || i == Math::DIRECTION_DOWN)
-				continue;
+			if (hit)
+				prefetchStats_.hits++;
+			else
+				prefetchStats_.misses++;
 
-			loadedChunks++;
-			AddChunk(playerChunkCoord + glm::ivec2(Math::directionVectors[i].x, Math::directionVectors[i].z));
+			prefetched_.Erase(coord);
+			chunk->RemoveDependent();
+			TryRemoveChunk(chunk);
+		}
+		else
+		{
+			index++;
 		}
 	}
 
-	// Update all chunks
-	ChunkContainer::iterator it = chunks_.begin();
-	while (it != chunks_.end())
+	if (glm::length(glm::vec2(velocity_.x, velocity_.z)) < World::prefetchMinSpeed)
+		return;
+
+	// Walk outward from the predicted chunk, skipping what the load queue already covers
+	glm::ivec2 center = ToChunkPosition(glm::floor(predicted));
+	if (center != prefetchCenter_)
 	{
-		// Update the height timer
-		it->second->UpdateHeightTimer(dt);
+		prefetchCenter_ = center;
+		prefetchCursor_ = 0;
+	}
+
+	const std::vector<glm::ivec2> &offsets = GetLoadOffsets();
+	size_t end = std::min(prefetchCursor_ + loadScanCount, offsets.size());
+	for (; prefetchCursor_ < end && prefetched_.Size() < World::prefetchLimit && workers_.GetQueuedCount() < maxQueued; prefetchCursor_++)
+	{
+		glm::ivec2 coord = center + offsets[prefetchCursor_];
+		glm::vec3 chunkPos = glm::vec3(coord.x, 0, coord.y) * float(World::chunkSize);
 
-		if (ChunkInRange(playerPos, it->second->GetWorldPos()))
+		if (!ChunkInRange(predicted, chunkPos, renderDistance_) || ChunkInRange(playerPos_, chunkPos, renderDistance_) || FindChunk(coord) != nullptr)
+			continue;
+
+		Chunk *chunk = LoadChunk(coord, true);
+		chunk->AddDependent();
+		prefetched_.Insert(coord, chunk);
+		prefetchStats_.queued++;
+	}
+}
+
+const std::vector<glm::ivec2> &ChunkManager::GetLoadOffsets()
+{
+	static const std::vector<glm::ivec2> offsets = []()
+	{
+		// Any chunk within render distance of some point in the player's chunk
+		int radius = int(std::ceil(World::renderDistance / World::chunkSize)) + 1;
+		float reach = float(radius) * radius;
+
+		std::vector<glm::ivec2> result;
+		for (int z = -radius; z <= radius; z++)
 		{
-			// Build meshes of all chunks and add unmeshed ones surrounding
-			if (loadedChunks < World::renderSpeed && !it->second->MeshBuilt() && BuiltNeighborCount(it->first) >= 3)
+			for (int x = -radius; x <= radius; x++)
 			{
-				loadedChunks++;
-				AddChunk(it->first);
+				if (float(x * x + z * z) <= reach)
+					result.push_back({ x, z });
 			}
+		}
 
-			// Move up if in range
-			it->second->SetHeightTimerIncreasing(true);
+		// Rings outward from the center
+		std::stable_sort(result.begin(), result.end(), [](glm::ivec2 lhs, glm::ivec2 rhs)
+		{
+			return lhs.x * lhs.x + lhs.y * lhs.y < rhs.x * rhs.x + rhs.y * rhs.y;
+		});
+
+		return result;
+	}();
+
+	return offsets;
+}
+
+void ChunkManager::InsertChunk(Chunk *chunk)
+{
+	glm::ivec2 coord = chunk->GetCoord();
+	chunks_.Insert(coord, chunk);
+	chunk->SetState(Chunk::STATE_GENERATED);
+
+	// Link with loaded surrounding chunks
+	for (unsigned i = 0; i < std::size(Math::surrounding); i++)
+	{
+		Chunk *neighbor = chunks_.Find(coord + Math::surrounding[i]);
+		if (neighbor != nullptr)
+		{
+			chunk->SetNeighbor(Math::surrounding[i], neighbor);
+			neighbor->SetNeighbor(-Math::surrounding[i], chunk);
 		}
-		// Move down if out of range
-		else if (it->second->MeshBuilt())
+	}
+
+	// This may have been the last chunk missing around itself or a neighbor
+	for (int z = -1; z <= 1; z++)
+	{
+		for (int x = -1; x <= 1; x++)
 		{
-			it->second->SetHeightTimerIncreasing(false);
+			Chunk *neighbor = chunk->GetNeighbor({ x, z });
+			if (neighbor == nullptr || neighbor->GetState() != Chunk::STATE_GENERATED || !neighbor->NeighborsLoaded())
+				continue;
+
+			neighbor->SetState(Chunk::STATE_NEIGHBORS_READY);
+			if (neighbor->MeshWanted())
+				QueueMesh(neighbor);
 		}
+	}
+}
 
-		// Unload if all the way down
-		if (it->second->HeightTimerHitZero())
+void ChunkManager::RemoveChunk(Chunk *chunk)
+{
+	glm::ivec2 coord = chunk->GetCoord();
+
+	// Unlink from surrounding chunks, none of them can be meshing since they'd depend on this one
+	for (unsigned i = 0; i < std::size(Math::surrounding); i++)
+	{
+		Chunk *neighbor = chunk->GetNeighbor(Math::surrounding[i]);
+		if (neighbor != nullptr)
 		{
-			// Delete surrounding chunks unconnected otherwise
-			for (unsigned i = 0; i < std::size(Math::surrounding); i++)
-			{
-				glm::ivec2 newCoord = it->first + Math::surrounding[i];
-				ChunkContainer::iterator chunk = chunks_.find(newCoord);
+			neighbor->SetNeighbor(-Math::surrounding[i], nullptr);
+			if (neighbor->GetState() == Chunk::STATE_NEIGHBORS_READY)
+				neighbor->SetState(Chunk::STATE_GENERATED);
+		}
+	}
 
-				if (chunk != chunks_.end() && !chunk->second->MeshBuilt() && BuiltNeighborCount(newCoord, it->first) == 0)
-				{
-					delete chunk->second;
-					chunks_.erase(chunk);
-				}
+	chunks_.Erase(coord);
+	ReleaseChunk(chunk);
+}
+
+void ChunkManager::ReleaseChunk(Chunk *chunk)
+{
+	ChunkData data = chunk->TakeBlockData();
+
+	// Edits are saved in the background, the cached copy matches what's saved
+	if (data.modified)
+	{
+		storage_.Save(chunk->GetCoord(), data, GetLogSequence(chunk->GetCoord()));
+		data.modified = false;
+	}
+
+	cache_.Store(chunk->GetCoord(), std::move(data));
+	pool_.Release(chunk);
+}
+
+void ChunkManager::TryRemoveChunk(Chunk *chunk)
+{
+	// Generating chunks are released when their job finishes
+	if (chunk->HasDependents() || chunk->HasJobReferences() || chunk->GetState() == Chunk::STATE_EMPTY)
+		return;
+
+	RemoveChunk(chunk);
+}
+
+bool ChunkManager::ChunkInRange(glm::vec3 playerPos, glm::vec3 chunkPos, float distance) const
+{
+	// Check if chunk is closer to player than distance
+	glm::vec3 pos = chunkPos + glm::vec3(World::chunkSize, 0.0f, World::chunkSize) / 2.f;
+	float distanceSquared = glm::distance2(glm::vec2(pos.x, pos.z), glm::vec2(playerPos.x, playerPos.z));
+	return distanceSquared <= distance * distance;
+}
+
+void ChunkManager::UpdateChunks(glm::vec3 playerPos, glm::vec3 viewDir, float dt)
+{
+	// Track movement for prefetching, teleports start over from rest
+	glm::vec3 moved = playerPos - playerPos_;
+	if (glm::length(moved) > teleportDistance || dt <= 0.0f)
+		velocity_ = glm::vec3(0.0f);
+	else
+		velocity_ = glm::mix(velocity_, moved / dt, velocitySmoothing);
+
+	playerPos_ = playerPos;
+	viewDir_ = viewDir;
+
+	scheduler_.BeginFrame();
+	ProcessResults();
+
+	// Keep enough jobs queued to cover the queue time, few enough that new requests are prioritized against the current position
+	size_t maxQueued = scheduler_.MaxQueuedJobs(workers_.GetThreadCount());
+
+	// Queue the nearest unmeshed chunks, the queue only changes when crossing a chunk border or turning
+	//	Entries past the render distance sort among the others since priority favors the view, so both loops pass over them
+	UpdateLoadQueue();
+	auto inRange = [&](glm::ivec2 coord)
+	{
+		return ChunkInRange(playerPos, glm::vec3(coord.x, 0, coord.y) * float(World::chunkSize), renderDistance_);
+	};
+
+	while (loadCursor_ < loadQueue_.size())
+	{
+		glm::ivec2 coord = loadQueue_[loadCursor_].coord;
+		Chunk *chunk = GetChunk(coord);
+		if (inRange(coord) && (chunk == nullptr || !chunk->MeshBuilt()))
+			break;
+
+		loadCursor_++;
+	}
+
+	size_t scanned = 0;
+	for (size_t i = loadCursor_; i < loadQueue_.size() && scanned < loadScanCount && workers_.GetQueuedCount() < maxQueued; i++)
+	{
+		glm::ivec2 coord = loadQueue_[i].coord;
+		if (!inRange(coord))
+			continue;
+
+		QueueChunk(coord);
+		scanned++;
+	}
+
+	// Prefetch with room left in the queue, its jobs run after every wanted chunk's
+	UpdatePrefetch(maxQueued * 2);
+
+	// Update all chunks
+	size_t chunkBytes = 0;
+	size_t meshBytes = ChunkMesh::GetSharedMemoryUsage();
+
+	// Released after the loop, removing chunks moves others into their slots and would skip them
+	std::vector<Chunk *> released;
+	for (size_t index = 0; index < chunks_.Size(); index++)
+	{
+		Chunk *chunk = chunks_.At(index);
+
+		// Update the height timer
+		chunk->UpdateHeightTimer(dt);
+
+		// Count memory before anything is released, it's still used this frame
+		chunkBytes += chunk->GetMemoryUsage();
+		meshBytes += chunk->GetMeshMemoryUsage();
+
+		// Loaded within the render distance but only unloaded past the farther unload distance
+		bool outOfRange = !ChunkInRange(playerPos, chunk->GetWorldPos(), unloadDistance_);
+		switch (chunk->GetState())
+		{
+		case Chunk::STATE_UPLOADED:
+			// Move down if out of range
+			if (outOfRange)
+			{
+				chunk->SetState(Chunk::STATE_UNLOADING);
+				chunk->SetHeightTimerIncreasing(false);
 			}
+			break;
 
-			// Only remove mesh of chunk
-			if (BuiltNeighborCount(it->first) > 0)
+		case Chunk::STATE_UNLOADING:
+			// Move back up if in range, unload if all the way down
+			if (!outOfRange)
 			{
-				it->second->ClearMesh();
-				++it;
+				chunk->SetState(Chunk::STATE_UPLOADED);
+				chunk->SetHeightTimerIncreasing(true);
 			}
-			else
+			else if (chunk->HeightTimerHitZero())
 			{
-				delete it->second;
-				ChunkContainer::iterator prev = it;
-				++it;
-				chunks_.erase(prev);
+				released.push_back(chunk);
 			}
+			break;
+
+		default:
+			// Wanted meshes the player left behind before they were built
+			if (chunk->MeshWanted() && outOfRange)
+				released.push_back(chunk);
+			break;
 		}
-		else
-			++it;
 	}
+
+	// Each chunk wants its own mesh until released, so none is removed before its turn
+	for (Chunk *chunk : released)
+		ReleaseMesh(chunk);
+
+	UpdateMemory(dt, chunkBytes, meshBytes);
+	UpdateCheckpoint(dt);
+
+	scheduler_.SetQueue(workers_.GetQueuedCount(), pendingGenerated_.size() + pendingMeshed_.size());
 }
 
 void ChunkManager::DrawChunksLit(const Camera &camera, const std::vector<CascadeShaderInfo> &cascadeInfo)
@@ -200,19 +733,20 @@ void ChunkManager::DrawChunksLit(const Camera &camera, const std::vector<Cascade
 void ChunkManager::DrawChunks(const glm::mat4 &cameraMatrix, const Shader &shader)
 {
 	shader.SetVar("cameraMatrix", cameraMatrix);
+	shader.SetVar("packedVertices", true);
 
 	Math::Frustum cameraFrustum = Math::CalculateFrustum(cameraMatrix);
-	for (const auto &c : chunks_)
+	for (Chunk *chunk : chunks_)
 	{
 		// Frustum culling
-		if (c.second->IsVisible(cameraFrustum))
+		if (chunk->IsVisible(cameraFrustum))
 		{
 			// Set shader/texture
-			glm::mat4 model = glm::translate(glm::mat4(1.0f), c.second->GetRenderPos());
+			glm::mat4 model = glm::translate(glm::mat4(1.0f), chunk->GetRenderPos());
 			shader.SetVar("modelMatrix", model);
 			shader.SetVar("normalMatrix", glm::transpose(glm::inverse(glm::mat3(model))));
 
-			c.second->Draw();
+			chunk->Draw();
 		}
 	}
 }
@@ -227,30 +761,40 @@ void ChunkManager::SetBlock(glm::ivec3 pos, const Block &block, bool network)
 	if (network)
 		NetworkManager::Instance().RegisterBlockUpdate({ block.type, pos });
 
-	chunk->SetBlock(pos, block);
+	{
+		// Background meshing may be reading this chunk
+		std::unique_lock<std::shared_mutex> lock(chunk->GetMutex());
+		chunk->SetBlock(pos, block);
+		if (!World::saveEditJournal)
+			chunk->MarkModified();
+	}
+
+	// Logged before anything else sees the edit, the disk write happens in the background
+	glm::ivec3 local = pos - glm::ivec3(chunk->GetWorldPos());
+	if (World::saveEditJournal)
+		journal_.Record(chunk->GetCoord(), local, block);
+	else
+		log_->Append(chunk->GetCoord(), local, block);
 
-	// Rebuild chunk mesh after modification
-	if (chunk->MeshBuilt())
-		chunk->BuildMesh();
+	// Rebuild chunk mesh after modification, replacing any queued mesh that may have missed it
+	if (chunk->MeshBuilt() || chunk->MeshQueued())
+		chunk->BuildMesh(greedyMeshing_);
 
 	// Rebuild surrounding chunks if block was on edge
 	for (std::size_t i = 0; i < std::size(Math::surrounding); i++)
 	{
 		Chunk *adjChunk = GetChunk(pos + glm::ivec3(Math::surrounding[i].x, 0.0f, Math::surrounding[i].y));
-		if (adjChunk != nullptr && adjChunk != chunk && adjChunk->MeshBuilt())
-			adjChunk->BuildMesh();
+		if (adjChunk != nullptr && adjChunk != chunk && (adjChunk->MeshBuilt() || adjChunk->MeshQueued()))
+			adjChunk->BuildMesh(greedyMeshing_);
 	}
 }
 
-const Block &ChunkManager::GetBlock(glm::ivec3 pos)
+Block ChunkManager::GetBlock(glm::ivec3 pos)
 {
 	Chunk *chunk = GetChunk(pos);
 
 	if (chunk == nullptr)
-	{
-		static Block error = { Block::BLOCK_ERROR };
-		return error;
-	}
+		return { Block::BLOCK_ERROR };
 
 	return chunk->GetBlock(pos);
 }
@@ -275,7 +819,7 @@ std::vector<BlockInfo> ChunkManager::GetBlocksInVolume(glm::vec3 pos, glm::vec3
 			for (int z = (int)glm::floor(zmin); z <= (int)glm::floor(zmax - (glm::fract(zmax) == 0.0f ? 1.0f : 0.0f)); z++)
 			{
 				glm::ivec3 coord = { x, y, z };
-				const Block &block = GetBlock(coord);
+				Block block = GetBlock(coord);
 				if (block.type != Block::BLOCK_AIR)
 				{
 					result.push_back(BlockInfo(coord, block));
@@ -359,6 +903,113 @@ ChunkManager::RaycastResult ChunkManager::Raycast(glm::vec3 pos, glm::vec3 dir,
 	}
 }
 
+size_t ChunkManager::GetChunkMemoryUsage() const
+{
+	size_t total = 0;
+	for (const Chunk *chunk : chunks_)
+		total += chunk->GetMemoryUsage();
+	return total;
+}
+
+size_t ChunkManager::GetChunkCount() const
+{
+	return chunks_.Size();
+}
+
+void ChunkManager::SetMemoryCaps(size_t chunkBytes, size_t meshBytes)
+{
+	chunkMemoryCap_ = chunkBytes;
+	meshMemoryCap_ = meshBytes;
+}
+
+const ChunkManager::MemoryStats &ChunkManager::GetMemoryStats() const
+{
+	return memoryStats_;
+}
+
+WorldStorage::Stats ChunkManager::GetStorageStats() const
+{
+	return storage_.GetStats();
+}
+
+EditJournal::Stats ChunkManager::GetJournalStats() const
+{
+	return journal_.GetStats();
+}
+
+WriteAheadLog::Stats ChunkManager::GetLogStats() const
+{
+	return log_ ? log_->GetStats() : WriteAheadLog::Stats();
+}
+
+const ChunkCache::Stats &ChunkManager::GetCacheStats() const
+{
+	return cache_.GetStats();
+}
+
+const ChunkPool::Stats &ChunkManager::GetPoolStats() const
+{
+	return pool_.GetStats();
+}
+
+size_t ChunkManager::GetQueuedJobCount() const
+{
+	return workers_.GetQueuedCount();
+}
+
+void ChunkManager::SetFrameBudget(float seconds)
+{
+	scheduler_.SetBudget(seconds);
+}
+
+float ChunkManager::GetFrameBudget() const
+{
+	return scheduler_.GetBudget();
+}
+
+const ChunkManager::PrefetchStats &ChunkManager::GetPrefetchStats() const
+{
+	return prefetchStats_;
+}
+
+const ChunkScheduler::Stats &ChunkManager::GetSchedulerStats() const
+{
+	return scheduler_.GetStats();
+}
+
+unsigned ChunkManager::GetWorkerCount() const
+{
+	return workers_.GetThreadCount();
+}
+
+void ChunkManager::SetGreedyMeshing(bool greedy)
+{
+	greedyMeshing_ = greedy;
+
+	// Rebuild every meshed chunk with the new mode
+	double start = glfwGetTime();
+	size_t rebuilt = 0;
+	size_t triangles = 0;
+	for (Chunk *chunk : chunks_)
+	{
+		if (!chunk->MeshBuilt())
+			continue;
+
+		chunk->BuildMesh(greedyMeshing_);
+		triangles += chunk->GetTriangleCount();
+		rebuilt++;
+	}
+	double elapsed = glfwGetTime() - start;
+
+	std::cout << "Greedy meshing " << (greedyMeshing_ ? "on" : "off") << ": " << rebuilt << " chunks, "
+		<< triangles << " triangles, " << elapsed * 1000.0 << " ms" << std::endl;
+}
+
+bool ChunkManager::GetGreedyMeshing() const
+{
+	return greedyMeshing_;
+}
+
 Shader &ChunkManager::GetShader()
 {
 	return shader_;
@@ -386,12 +1037,7 @@ Chunk *ChunkManager::GetChunk(glm::ivec2 chunkCoord)
 
 const Chunk *ChunkManager::GetChunk(glm::ivec2 chunkCoord) const
 {
-	auto result = chunks_.find(chunkCoord);
-
-	if (result == chunks_.end())
-		return nullptr;
-
-	return result->second;
+	return chunks_.Find(chunkCoord);
 }
 
 glm::ivec2 ChunkManager::ToRelativePosition(glm::ivec3 pos) const
@@ -1,7 +1,8 @@
 #pragma once
 
 #include <vector>
-#include <unordered_map>
+#include <memory>
+#include <mutex>
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/hash.hpp>
@@ -11,6 +12,15 @@
 #include "Math.h"
 #include "TerrainGenerator.h"
 #include "Shader.h"
+#include "ChunkPool.h"
+#include "ChunkMap.h"
+#include "ChunkMesh.h"
+#include "WorkerPool.h"
+#include "ChunkScheduler.h"
+#include "ChunkCache.h"
+#include "WorldStorage.h"
+#include "EditJournal.h"
+#include "WriteAheadLog.h"
 
 class Chunk;
 class Camera;
@@ -36,8 +46,8 @@ public:
 		Math::Direction normal;
 	};
 
-	// Load and unload chunks for this frame
-	void UpdateChunks(glm::vec3 playerPos, float dt);
+	// Load and unload chunks for this frame, chunks in view are loaded first
+	void UpdateChunks(glm::vec3 playerPos, glm::vec3 viewDir, float dt);
 
 	// Draw all chunks with lighting calculations
 	void DrawChunksLit(const Camera &camera, const std::vector<CascadeShaderInfo> &cascadeInfo);
@@ -47,33 +57,155 @@ public:
 
 	// World block getters/setters
 	void SetBlock(glm::ivec3 pos, const Block &block, bool network = false);
-	const Block &GetBlock(glm::ivec3 pos);
+	Block GetBlock(glm::ivec3 pos);
+
+	// Chunk getters, nullptr if not loaded
+	Chunk *GetChunk(glm::ivec3 pos);
+	const Chunk *GetChunk(glm::ivec3 pos) const;
+	Chunk *GetChunk(glm::ivec2 chunkCoord);
+	const Chunk *GetChunk(glm::ivec2 chunkCoord) const;
 
 	// Utility functions
 	std::vector<BlockInfo> GetBlocksInVolume(glm::vec3 pos, glm::vec3 size);
 	RaycastResult Raycast(glm::vec3 pos, glm::vec3 dir, float length = INFINITY);
 
+	// Memory info
+	size_t GetChunkMemoryUsage() const; // bytes of block data for all loaded chunks
+	size_t GetChunkCount() const;
+	const ChunkPool::Stats &GetPoolStats() const;
+	const ChunkCache::Stats &GetCacheStats() const;
+	WorldStorage::Stats GetStorageStats() const;
+	EditJournal::Stats GetJournalStats() const;
+	WriteAheadLog::Stats GetLogStats() const;
+
+	// Memory usage against the caps, as of the last update
+	struct MemoryStats
+	{
+		size_t chunkBytes; // block data of loaded chunks
+		size_t cacheBytes; // block data of unloaded chunks
+		size_t meshBytes; // chunk mesh buffers, including shared index buffers
+		size_t chunkCap; // loaded and cached block data
+		size_t meshCap;
+		float renderDistance; // shrunk while over a cap
+	};
+	void SetMemoryCaps(size_t chunkBytes, size_t meshBytes);
+	const MemoryStats &GetMemoryStats() const;
+
+	// Background job info
+	size_t GetQueuedJobCount() const;
+	unsigned GetWorkerCount() const;
+
+	// Prefetch counters, hits are prefetched chunks that were needed before being dropped
+	struct PrefetchStats
+	{
+		size_t queued = 0;
+		size_t hits = 0;
+		size_t misses = 0;
+	};
+	const PrefetchStats &GetPrefetchStats() const;
+
+	// Frame budget for adding and uploading finished chunks, leftover work waits for the next frame
+	void SetFrameBudget(float seconds);
+	float GetFrameBudget() const;
+	const ChunkScheduler::Stats &GetSchedulerStats() const;
+
 	// Rendering functions
 	Shader &GetShader();
+	void SetGreedyMeshing(bool greedy); // rebuilds all meshes and reports triangle count and build time
+	bool GetGreedyMeshing() const;
 
 private:
-	typedef std::unordered_map<glm::ivec2, Chunk *> ChunkContainer;
+	typedef ChunkMap ChunkContainer;
+
+	// Finished background generation, waiting to be added
+	struct GenerateResult
+	{
+		Chunk *chunk;
+		float seconds; // time the job took
+	};
+
+	// Finished background mesh, waiting for upload
+	struct MeshResult
+	{
+		Chunk *chunk;
+		unsigned ticket;
+		std::array<Chunk *, 9> sources; // chunks the job referenced
+		ChunkMeshData data;
+		float seconds;
+	};
 
 	Shader shader_;
 	Texture texture_;
 	ChunkContainer chunks_;
 	TerrainGenerator noise_;
+	ChunkPool pool_;
+	ChunkCache cache_; // unloaded block data
+	std::unique_ptr<WriteAheadLog> log_; // edits not yet saved with their chunks, only with region saves; outlives storage_ since saves checkpoint it
+	WorldStorage storage_; // edited chunks on disk
+	EditJournal journal_; // block edits replayed over generated terrain
+	bool greedyMeshing_;
+
+	// Background generation and meshing
+	ChunkContainer generating_; // chunks being generated, not in chunks_ until finished
+	std::mutex resultsMutex_; // guards the finished lists below
+	std::vector<GenerateResult> generated_;
+	std::vector<MeshResult> meshed_;
+	std::vector<GenerateResult> pendingGenerated_; // taken from the finished lists, waiting for frame budget
+	std::vector<MeshResult> pendingMeshed_;
+	glm::vec3 playerPos_; // for job priorities
+	glm::vec3 viewDir_;
+
+	// Chunks to load around the player, best priority first
+	struct LoadEntry
+	{
+		glm::ivec2 coord;
+		float priority;
+	};
+	std::vector<LoadEntry> loadQueue_;
+	size_t loadCursor_; // entries before this are meshed
+	glm::ivec2 loadCenter_; // player chunk the queue was built around
+	glm::vec2 loadView_; // view direction the queue was sorted with
+
+	// Generation ahead of player movement
+	ChunkContainer prefetched_; // chunks held by prefetching, each has one dependent for it
+	glm::vec3 velocity_; // smoothed player movement, blocks per second
+	glm::ivec2 prefetchCenter_; // predicted player chunk the cursor walks around
+	size_t prefetchCursor_; // load offsets checked so far around the predicted chunk
+	PrefetchStats prefetchStats_;
+
+	// Memory governing
+	float renderDistance_; // load distance, shrunk from the world setting while over memory caps
+	float unloadDistance_;
+	size_t chunkMemoryCap_;
+	size_t meshMemoryCap_;
+	float memoryTimer_; // seconds since the caps were last checked
+	MemoryStats memoryStats_;
+	float checkpointTimer_; // seconds since edited chunks were last saved while loaded
+	ChunkScheduler scheduler_;
+	WorkerPool workers_;
 
 	ChunkManager();
 	~ChunkManager();
-	Chunk *AddChunk(glm::ivec2 coord); // adds completed chunk to buffer, generates surrounding chunks
-	bool ChunkInRange(glm::vec3 playerPos, glm::vec3 chunkPos) const; // if chunk should stay loaded
-	int BuiltNeighborCount(glm::ivec2 coord) const; // how many surrounding chunks' meshes are built
-	int BuiltNeighborCount(glm::ivec2 coord, glm::ivec2 exclude) const;
-	Chunk *GetChunk(glm::ivec3 pos); // Chunk getters
-	const Chunk *GetChunk(glm::ivec3 pos) const;
-	Chunk *GetChunk(glm::ivec2 chunkCoord);
-	const Chunk *GetChunk(glm::ivec2 chunkCoord) const;
+	void QueueChunk(glm::ivec2 coord); // want a chunk's mesh, generating it and its surrounding chunks in the background first
+	void ReleaseMesh(Chunk *chunk); // stop wanting a chunk's mesh, removing chunks nothing depends on anymore
+	Chunk *LoadChunk(glm::ivec2 coord, bool prefetch = false); // loaded or generating chunk, generation is queued if neither; prefetches run after everything else
+	Chunk *FindChunk(glm::ivec2 coord) const; // loaded or generating chunk, nullptr if neither
+	uint64_t GetLogSequence(glm::ivec2 coord) const; // newest logged edit of a chunk, zero without a log
+	void RecoverEdits(); // save the chunks of edits a crash kept out of the region files, so the log doesn't wait for them to load
+	void QueueMesh(Chunk *chunk); // mesh a chunk with all surrounding chunks loaded in the background
+	void ProcessResults(); // add generated chunks and upload finished meshes within the frame budget
+	float JobPriority(glm::ivec2 coord) const; // lower runs first, by distance and view direction
+	void UpdateLoadQueue(); // rebuild the load queue if the player changed chunks or turned
+	void UpdatePrefetch(size_t maxQueued); // generate chunks around where the player is heading, dropping ones it didn't reach
+	void UpdateMemory(float dt, size_t chunkBytes, size_t meshBytes); // give the cache what's left of the caps, shrink or grow the render distance to fit
+	void UpdateCheckpoint(float dt); // save loaded chunks with edits every checkpoint interval, so the log can be truncated
+	void SetRenderDistance(float distance); // set the load and unload distances and fog, and restart the load scan
+	static const std::vector<glm::ivec2> &GetLoadOffsets(); // chunk offsets that can be in render distance, nearest first
+	void InsertChunk(Chunk *chunk); // add a chunk to the container and link its neighbors
+	void RemoveChunk(Chunk *chunk); // unlink a chunk, remove it from the container and return it to the pool
+	void ReleaseChunk(Chunk *chunk); // save edits and cache a generated chunk's blocks, then return it to the pool
+	void TryRemoveChunk(Chunk *chunk); // remove a chunk if nothing depends on it or reads it
+	bool ChunkInRange(glm::vec3 playerPos, glm::vec3 chunkPos, float distance) const; // if chunk center is within distance of the player
 	glm::ivec2 ToRelativePosition(glm::ivec3 pos) const; // Convert block coord to local coord
 	glm::ivec2 ToChunkPosition(glm::ivec3 pos) const; // Convert world coord to chunk coord
 
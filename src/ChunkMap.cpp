@@ -0,0 +1,144 @@
+#include "ChunkMap.h"
+
+ChunkMap::ChunkMap(size_t reserve)
+{
+	// Keep load factor at or below one half
+	size_t slotCount = 16;
+	while (slotCount < reserve * 2)
+		slotCount *= 2;
+
+	Rehash(slotCount);
+	chunks_.reserve(reserve);
+	coords_.reserve(reserve);
+}
+
+Chunk *ChunkMap::Find(glm::ivec2 coord) const
+{
+	const Slot &slot = slots_[FindSlot(coord)];
+
+	if (slot.index == emptySlot)
+		return nullptr;
+
+	return chunks_[slot.index];
+}
+
+void ChunkMap::Insert(glm::ivec2 coord, Chunk *chunk)
+{
+	size_t slot = FindSlot(coord);
+
+	// Replace existing
+	if (slots_[slot].index != emptySlot)
+	{
+		chunks_[slots_[slot].index] = chunk;
+		return;
+	}
+
+	slots_[slot] = { coord, uint32_t(chunks_.size()) };
+	chunks_.push_back(chunk);
+	coords_.push_back(coord);
+
+	if (chunks_.size() * 2 > slots_.size())
+		Rehash(slots_.size() * 2);
+}
+
+bool ChunkMap::Erase(glm::ivec2 coord)
+{
+	const Slot &slot = slots_[FindSlot(coord)];
+
+	if (slot.index == emptySlot)
+		return false;
+
+	EraseAt(slot.index);
+	return true;
+}
+
+void ChunkMap::EraseAt(size_t index)
+{
+	size_t hole = FindSlot(coords_[index]);
+
+	// Backward shift deletion, pull later entries of the probe run into the hole
+	size_t next = (hole + 1) & mask_;
+	while (slots_[next].index != emptySlot)
+	{
+		// Move entry if its ideal slot is not cyclically between the hole and it
+		size_t ideal = Hash(slots_[next].coord);
+		if (((next - ideal) & mask_) >= ((next - hole) & mask_))
+		{
+			slots_[hole] = slots_[next];
+			hole = next;
+		}
+		next = (next + 1) & mask_;
+	}
+	slots_[hole].index = emptySlot;
+
+	// Move last dense entry into the erased position
+	size_t last = chunks_.size() - 1;
+	if (index != last)
+	{
+		chunks_[index] = chunks_[last];
+		coords_[index] = coords_[last];
+		slots_[FindSlot(coords_[index])].index = uint32_t(index);
+	}
+	chunks_.pop_back();
+	coords_.pop_back();
+}
+
+void ChunkMap::Clear()
+{
+	chunks_.clear();
+	coords_.clear();
+	for (Slot &slot : slots_)
+		slot.index = emptySlot;
+}
+
+size_t ChunkMap::Size() const
+{
+	return chunks_.size();
+}
+
+Chunk *ChunkMap::At(size_t index) const
+{
+	return chunks_[index];
+}
+
+glm::ivec2 ChunkMap::CoordAt(size_t index) const
+{
+	return coords_[index];
+}
+
+Chunk *const *ChunkMap::begin() const
+{
+	return chunks_.data();
+}
+
+Chunk *const *ChunkMap::end() const
+{
+	return chunks_.data() + chunks_.size();
+}
+
+size_t ChunkMap::Hash(glm::ivec2 coord) const
+{
+	// Multiplicative hash of both axes, upper bits folded down
+	uint32_t h = uint32_t(coord.x) * 0x9E3779B1u ^ uint32_t(coord.y) * 0x85EBCA77u;
+	h ^= h >> 16;
+	return h & mask_;
+}
+
+size_t ChunkMap::FindSlot(glm::ivec2 coord) const
+{
+	size_t slot = Hash(coord);
+
+	while (slots_[slot].index != emptySlot && slots_[slot].coord != coord)
+		slot = (slot + 1) & mask_;
+
+	return slot;
+}
+
+void ChunkMap::Rehash(size_t slotCount)
+{
+	slots_.assign(slotCount, { glm::ivec2(0), emptySlot });
+	mask_ = slotCount - 1;
+
+	for (size_t i = 0; i < coords_.size(); i++)
+		slots_[FindSlot(coords_[i])] = { coords_[i], uint32_t(i) };
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+class Chunk;
+
+// Chunk coord to chunk lookup
+//	Chunks are stored densely for contiguous iteration and indexed by a
+//	linear probing hash table that stores coords inline, so lookups never
+//	touch the chunks themselves
+class ChunkMap
+{
+public:
+	ChunkMap(size_t reserve = 0);
+
+	// Get the chunk at a coord, nullptr if not present
+	Chunk *Find(glm::ivec2 coord) const;
+
+	// Add or replace the chunk at a coord
+	void Insert(glm::ivec2 coord, Chunk *chunk);
+
+	// Remove the chunk at a coord, returns false if not present
+	bool Erase(glm::ivec2 coord);
+
+	// Remove the chunk at a dense index, the last chunk moves into its place
+	void EraseAt(size_t index);
+
+	// Remove all chunks
+	void Clear();
+
+	// Dense access, index order changes when erasing
+	size_t Size() const;
+	Chunk *At(size_t index) const;
+	glm::ivec2 CoordAt(size_t index) const;
+	Chunk *const *begin() const;
+	Chunk *const *end() const;
+
+private:
+	static const uint32_t emptySlot = UINT32_MAX;
+
+	// Hash table entry
+	struct Slot
+	{
+		glm::ivec2 coord;
+		uint32_t index; // into dense arrays
+	};
+
+	std::vector<Chunk *> chunks_;
+	std::vector<glm::ivec2> coords_;
+	std::vector<Slot> slots_; // power of two size
+	size_t mask_;
+
+	size_t Hash(glm::ivec2 coord) const; // starting slot for a coord
+	size_t FindSlot(glm::ivec2 coord) const; // slot holding a coord, or the empty slot ending its probe
+	void Rehash(size_t slotCount); // resize the table and reinsert all coords
+};
@@ -0,0 +1,214 @@
+#include "ChunkMesh.h"
+#include "Mesh.h"
+#include "../shaders/Shared.h"
+
+#include <algorithm>
+
+GLuint ChunkMesh::shortIndices_ = 0;
+GLuint ChunkMesh::intIndices_ = 0;
+size_t ChunkMesh::intIndexQuads_ = 0;
+
+void ChunkMeshData::AddQuad(Math::Direction orientation, glm::ivec3 block, glm::ivec2 size, unsigned tile, const unsigned char ambients[], bool flip)
+{
+	int axis = orientation / 2;
+	int axisU = Mesh::quadAxes[orientation][0];
+	int axisV = Mesh::quadAxes[orientation][1];
+
+	// Faces pointing in a positive direction are on the far side of the block
+	glm::ivec3 origin = block;
+	origin[axis] += Math::directionVectors[orientation][axis] > 0.0f ? 1 : 0;
+
+	uint32_t texture = tile | uint32_t(size.x) << PACKED_WIDTH_SHIFT | uint32_t(size.y) << PACKED_HEIGHT_SHIFT;
+
+	for (unsigned i = 0; i < Math::CORNER_COUNT; i++)
+	{
+		// Stretch the base quad's corner over the size
+		const glm::vec3 &base = Mesh::quads[orientation][i].position;
+		glm::ivec3 corner = origin;
+		corner[axisU] += base[axisU] > 0.0f ? size.x : 0;
+		corner[axisV] += base[axisV] > 0.0f ? size.y : 0;
+
+		uint32_t position =
+			uint32_t(corner.x) |
+			uint32_t(corner.y) << PACKED_Y_SHIFT |
+			uint32_t(corner.z) << PACKED_Z_SHIFT |
+			uint32_t(orientation) << PACKED_NORMAL_SHIFT |
+			uint32_t(ambients[i]) << PACKED_AMBIENT_SHIFT |
+			uint32_t(i) << PACKED_CORNER_SHIFT;
+
+		vertices_.push_back({ position, texture });
+	}
+
+	// Flip quad to split along the other diagonal
+	if (flip)
+	{
+		std::swap(*(vertices_.end() - 4), *(vertices_.end() - 2));
+		std::swap(*(vertices_.end() - 3), *(vertices_.end() - 1));
+		std::swap(*(vertices_.end() - 3), *(vertices_.end() - 2));
+	}
+}
+
+void ChunkMeshData::Clear()
+{
+	vertices_.clear();
+}
+
+size_t ChunkMeshData::QuadCount() const
+{
+	return vertices_.size() / Math::CORNER_COUNT;
+}
+
+const std::vector<ChunkVertex> &ChunkMeshData::GetVertices() const
+{
+	return vertices_;
+}
+
+ChunkMesh::ChunkMesh()
+{
+	SetupObjects();
+}
+
+void ChunkMesh::Upload(const ChunkMeshData &data)
+{
+	const std::vector<ChunkVertex> &vertices = data.GetVertices();
+
+	// Send VBO
+	vertexBytes_ = vertices.size() * sizeof(*vertices.data());
+	glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+	glBufferData(GL_ARRAY_BUFFER, vertexBytes_, vertices.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// Bind the shared index buffer that covers this mesh, 16 bit when every vertex is reachable
+	size_t quads = data.QuadCount();
+	indexType_ = quads <= shortIndexQuads ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	GLuint indices = GetIndexBuffer(quads, indexType_);
+	glBindVertexArray(vao_);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices);
+	glBindVertexArray(0);
+
+	indexCount_ = GLsizei(quads * std::size(Mesh::quadIndices));
+}
+
+void ChunkMesh::Clear()
+{
+	indexCount_ = 0;
+
+	// Free the vertex storage, pooled meshes would hold onto it otherwise
+	if (vertexBytes_ != 0)
+	{
+		vertexBytes_ = 0;
+		glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+		glBufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+}
+
+unsigned ChunkMesh::IndexCount() const
+{
+	return indexCount_;
+}
+
+size_t ChunkMesh::GetMemoryUsage() const
+{
+	return vertexBytes_;
+}
+
+size_t ChunkMesh::GetSharedMemoryUsage()
+{
+	size_t total = intIndexQuads_ * std::size(Mesh::quadIndices) * sizeof(GLuint);
+	if (shortIndices_ != 0)
+		total += shortIndexQuads * std::size(Mesh::quadIndices) * sizeof(GLushort);
+	return total;
+}
+
+void ChunkMesh::ReleaseShared()
+{
+	// Deleting zero names is ignored
+	glDeleteBuffers(1, &shortIndices_);
+	glDeleteBuffers(1, &intIndices_);
+	shortIndices_ = 0;
+	intIndices_ = 0;
+	intIndexQuads_ = 0;
+}
+
+void ChunkMesh::Draw()
+{
+	if (indexCount_ == 0)
+		return;
+
+	glBindVertexArray(vao_);
+
+	// Draw
+	glDrawElements(GL_TRIANGLES, indexCount_, indexType_, nullptr);
+
+	glBindVertexArray(0);
+}
+
+ChunkMesh::~ChunkMesh()
+{
+	glDeleteVertexArrays(1, &vao_);
+	glDeleteBuffers(1, &vbo_);
+}
+
+void ChunkMesh::SetupObjects()
+{
+	indexCount_ = 0;
+	vertexBytes_ = 0;
+	indexType_ = GL_UNSIGNED_SHORT;
+
+	// VBO
+	glGenBuffers(1, &vbo_);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+
+	// VAO
+	glGenVertexArrays(1, &vao_);
+	glBindVertexArray(vao_);
+
+	// packed data, read as integers
+	glVertexAttribIPointer(4, 2, GL_UNSIGNED_INT, sizeof(ChunkVertex), (void *)offsetof(ChunkVertex, position));
+	glEnableVertexAttribArray(4);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+GLuint ChunkMesh::GetIndexBuffer(size_t quads, GLenum type)
+{
+	// Fill a buffer with the quad pattern offset for each quad
+	auto generate = [](GLuint &buffer, size_t count, auto index)
+	{
+		std::vector<decltype(index)> indices;
+		indices.reserve(count * std::size(Mesh::quadIndices));
+		for (size_t quad = 0; quad < count; quad++)
+		{
+			for (unsigned current : Mesh::quadIndices)
+				indices.push_back(decltype(index)(current + quad * Math::CORNER_COUNT));
+		}
+
+		if (buffer == 0)
+			glGenBuffers(1, &buffer);
+
+		// Bind through the array buffer target so no vao's element binding changes
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glBufferData(GL_ARRAY_BUFFER, indices.size() * sizeof(*indices.data()), indices.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	};
+
+	if (type == GL_UNSIGNED_SHORT)
+	{
+		// Short buffer covers everything 16 bits can reach
+		if (shortIndices_ == 0)
+			generate(shortIndices_, shortIndexQuads, GLushort());
+
+		return shortIndices_;
+	}
+
+	// Int buffer grows to the largest mesh, existing vaos keep the same buffer name
+	if (quads > intIndexQuads_)
+	{
+		intIndexQuads_ = quads;
+		generate(intIndices_, intIndexQuads_, GLuint());
+	}
+
+	return intIndices_;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "glad/glad.h"
+#include <glm/glm.hpp>
+
+#include "Math.h"
+
+// Packed chunk vertex, layout is described in Shared.h
+struct ChunkVertex
+{
+	uint32_t position; // position, normal, ambient, and corner
+	uint32_t texture; // tile index and quad size
+};
+
+// Packed block faces of a chunk mesh on the cpu, can be built on any thread
+//	Positions are local block corners, so this only holds chunk geometry; other meshes use Mesh
+class ChunkMeshData
+{
+public:
+	// Add a face quad starting at a local block, size stretches the quad along its axes and repeats its tile
+	void AddQuad(
+		Math::Direction orientation,
+		glm::ivec3 block,
+		glm::ivec2 size,
+		unsigned tile,
+		const unsigned char ambients[],
+		bool flip // reverse the diagonal so ambient occlusion interpolates correctly
+	);
+
+	// Clear all vertices, keeping memory
+	void Clear();
+
+	// Get info
+	size_t QuadCount() const;
+	const std::vector<ChunkVertex> &GetVertices() const;
+
+private:
+	std::vector<ChunkVertex> vertices_;
+};
+
+// Wrapper for graphics api mesh of a chunk, main thread only
+//	Every quad uses the same index pattern, so all chunk meshes share one quad index buffer
+class ChunkMesh
+{
+public:
+	// Create empty mesh
+	ChunkMesh();
+
+	// Replace the gpu data with built quads
+	void Upload(const ChunkMeshData &data);
+
+	// Remove all quads
+	void Clear();
+
+	// Get info
+	unsigned IndexCount() const;
+	size_t GetMemoryUsage() const; // bytes of vertex buffer
+	static size_t GetSharedMemoryUsage(); // bytes of index buffers shared by all chunk meshes
+
+	// Delete the index buffers shared by all chunk meshes, at shutdown once nothing draws them
+	static void ReleaseShared();
+
+	// Draws the mesh
+	void Draw();
+
+	~ChunkMesh();
+
+private:
+	// Most quads 16 bit indices can reach
+	static const size_t shortIndexQuads = 0x10000 / Math::CORNER_COUNT;
+
+	GLuint vbo_;
+	GLuint vao_;
+	GLsizei indexCount_;
+	size_t vertexBytes_;
+	GLenum indexType_; // type of the shared index buffer bound to the vao
+
+	// Shared quad index buffers
+	static GLuint shortIndices_;
+	static GLuint intIndices_;
+	static size_t intIndexQuads_; // quads covered by intIndices_
+
+	void SetupObjects(); // Create initial gpu data
+	static GLuint GetIndexBuffer(size_t quads, GLenum type); // shared index buffer covering quads, grown if needed
+
+public: // Owns gpu objects, disallow copies
+	ChunkMesh(ChunkMesh const &) = delete;
+	void operator=(ChunkMesh const &) = delete;
+};
@@ -0,0 +1,390 @@
+#include "ChunkMesher.h"
+#include "Chunk.h"
+#include "Mesh.h"
+#include "ChunkMesh.h"
+
+#include <algorithm>
+#include <iterator>
+#include <shared_mutex>
+
+void ChunkMesher::Load(const Chunk &chunk)
+{
+	// Keep block data from changing while it's copied, chunks are only written on the main thread
+	std::array<std::shared_lock<std::shared_mutex>, 9> locks;
+	for (int z = -1; z <= 1; z++)
+	{
+		for (int x = -1; x <= 1; x++)
+		{
+			const Chunk *source = chunk.GetNeighbor({ x, z });
+			if (source != nullptr)
+				locks[(x + 1) + (z + 1) * 3] = std::shared_lock<std::shared_mutex>(source->GetMutex());
+		}
+	}
+
+	// Faces are only possible up to the highest block, which needs the layer above it
+	top_ = chunk.GetHighestBlock();
+	int layers = glm::min(top_ + 2, int(World::chunkHeight));
+
+	// One layer of air padding below and above
+	blocks_.assign(size_t(paddedSize) * paddedSize * (top_ + 3), Block::BLOCK_AIR);
+	solid_.assign(size_t(paddedSize) * (top_ + 3), 0);
+
+	for (int y = 0; y < layers; y++)
+	{
+		int section = y / World::sectionHeight;
+		int local = (y % World::sectionHeight) * World::chunkArea;
+
+		for (int z = -1; z <= int(World::chunkSize); z++)
+		{
+			int offsetZ = z < 0 ? -1 : (z >= int(World::chunkSize) ? 1 : 0);
+			int localZ = z - offsetZ * World::chunkSize;
+
+			// Row from the left neighbor, this row's chunk, and the right neighbor
+			for (int offsetX = -1; offsetX <= 1; offsetX++)
+			{
+				const Chunk *source = chunk.GetNeighbor({ offsetX, offsetZ });
+				if (source == nullptr)
+					continue;
+
+				const BlockStorage &storage = source->GetSection(section);
+				int start = offsetX == 0 ? 0 : (offsetX < 0 ? World::chunkSize - 1 : 0);
+				int end = offsetX == 0 ? World::chunkSize : start + 1;
+
+				Row &row = solid_[RowIndex(y, z)];
+				for (int localX = start; localX < end; localX++)
+				{
+					int x = localX + offsetX * World::chunkSize;
+					Block::BlockType type = storage.Get(localX + local + localZ * World::chunkSize).type;
+					blocks_[Index({ x, y, z })] = type;
+					row |= Row(type != Block::BLOCK_AIR) << (x + 1);
+				}
+			}
+		}
+	}
+
+	for (int i = 0; i < int(World::sectionCount); i++)
+		hiddenSections_[i] = SectionHidden(chunk, i);
+
+	CullFaces();
+}
+
+void ChunkMesher::CullFaces()
+{
+	const Row interior = (Row(1) << World::chunkSize) - 1;
+
+	for (int d = 0; d < Math::DIRECTION_COUNT; d++)
+		visible_[d].assign(size_t(World::chunkSize) * (top_ + 1), 0);
+
+	for (int y = 0; y <= top_; y++)
+	{
+		// Hidden sections keep empty masks
+		if (hiddenSections_[y / World::sectionHeight])
+			continue;
+
+		for (int z = 0; z < World::chunkSize; z++)
+		{
+			// A face is visible where a solid block has no solid block next to it, a whole row at a time
+			Row row = solid_[RowIndex(y, z)];
+			size_t index = size_t(z) + size_t(y) * World::chunkSize;
+
+			visible_[Math::DIRECTION_LEFT][index] = FaceMask(((row & ~(row >> 1)) >> 1) & interior);
+			visible_[Math::DIRECTION_RIGHT][index] = FaceMask(((row & ~(row << 1)) >> 1) & interior);
+			visible_[Math::DIRECTION_UP][index] = FaceMask(((row & ~solid_[RowIndex(y + 1, z)]) >> 1) & interior);
+			visible_[Math::DIRECTION_FORWARD][index] = FaceMask(((row & ~solid_[RowIndex(y, z + 1)]) >> 1) & interior);
+			visible_[Math::DIRECTION_BACKWARD][index] = FaceMask(((row & ~solid_[RowIndex(y, z - 1)]) >> 1) & interior);
+
+			// Bottom of the world is never drawn
+			if (y > 0)
+				visible_[Math::DIRECTION_DOWN][index] = FaceMask(((row & ~solid_[RowIndex(y - 1, z)]) >> 1) & interior);
+		}
+	}
+}
+
+void ChunkMesher::Build(ChunkMeshData &mesh, bool greedy)
+{
+	if (greedy)
+		BuildGreedy(mesh);
+	else
+		BuildFaces(mesh);
+}
+
+void ChunkMesher::BuildFaces(ChunkMeshData &mesh) const
+{
+	// Loop over all blocks before sky
+	for (int y = 0; y <= top_; y++)
+	{
+		// Skip whole sections that can't have visible faces
+		if (y % World::sectionHeight == 0 && hiddenSections_[y / World::sectionHeight])
+		{
+			y += World::sectionHeight - 1;
+			continue;
+		}
+
+		for (int z = 0; z < World::chunkSize; z++)
+		{
+			size_t index = size_t(z) + size_t(y) * World::chunkSize;
+
+			// Only visit blocks with at least one visible face
+			unsigned blocks = 0;
+			for (int d = 0; d < Math::DIRECTION_COUNT; d++)
+				blocks |= visible_[d][index];
+
+			while (blocks != 0)
+			{
+				int x = int(Math::CountTrailingZeros(blocks));
+				blocks &= blocks - 1;
+
+				Block::BlockType type = GetBlock({ x, y, z });
+				for (int d = 0; d < Math::DIRECTION_COUNT; d++)
+				{
+					if ((visible_[d][index] >> x & 1) == 0)
+						continue;
+
+					glm::ivec3 adjacent = glm::ivec3(x, y, z) + glm::ivec3(Math::directionVectors[d]);
+					const Occlusion &occlusion = GetOcclusion(adjacent, Math::Direction(d));
+					mesh.AddQuad(Math::Direction(d), { x, y, z }, { 1, 1 }, TextureIndex(type, Math::Direction(d)), occlusion.ambient, occlusion.flip);
+				}
+			}
+		}
+	}
+}
+
+void ChunkMesher::BuildGreedy(ChunkMeshData &mesh)
+{
+	for (int d = 0; d < Math::DIRECTION_COUNT; d++)
+	{
+		Math::Direction dir = Math::Direction(d);
+		glm::ivec3 normal = Math::directionVectors[d];
+
+		// Slice along the normal, faces merge along the quad's axes
+		int axis = d / 2;
+		int axisU = Mesh::quadAxes[d][0];
+		int axisV = Mesh::quadAxes[d][1];
+		glm::ivec3 extents = { World::chunkSize, top_ + 1, World::chunkSize };
+		int sizeU = extents[axisU];
+		int sizeV = extents[axisV];
+		faces_.resize(size_t(sizeU) * sizeV);
+
+		for (int slice = 0; slice < extents[axis]; slice++)
+		{
+			// Find visible faces in this slice from the face masks
+			for (int v = 0; v < sizeV; v++)
+			{
+				Face *row = &faces_[size_t(v) * sizeU];
+				for (int u = 0; u < sizeU; u++)
+					row[u].exists = false;
+
+				unsigned bits = 0;
+				if (axis == Math::AXIS_X) // u runs along z, gather one bit per mask
+				{
+					for (int u = 0; u < sizeU; u++)
+						bits |= unsigned(visible_[d][size_t(u) + size_t(v) * World::chunkSize] >> slice & 1) << u;
+				}
+				else if (axis == Math::AXIS_Y) // u runs along x, v along z
+					bits = visible_[d][size_t(v) + size_t(slice) * World::chunkSize];
+				else // u runs along x, v along y
+					bits = visible_[d][size_t(slice) + size_t(v) * World::chunkSize];
+
+				while (bits != 0)
+				{
+					int u = int(Math::CountTrailingZeros(bits));
+					bits &= bits - 1;
+
+					glm::ivec3 pos;
+					pos[axis] = slice;
+					pos[axisU] = u;
+					pos[axisV] = v;
+
+					Face &face = row[u];
+					face.exists = true;
+					face.texture = TextureIndex(GetBlock(pos), dir);
+					face.occlusion = GetOcclusion(pos + normal, dir);
+				}
+			}
+
+			// Merge runs of equal faces into rectangles, first along u then v
+			for (int v = 0; v < sizeV; v++)
+			{
+				for (int u = 0; u < sizeU; u++)
+				{
+					Face face = faces_[u + v * sizeU];
+					if (!face.exists)
+						continue;
+
+					// Only merge faces with even ambient occlusion, otherwise corner shading would stretch
+					glm::ivec2 size = { 1, 1 };
+					const unsigned char *ambient = face.occlusion.ambient;
+					if (ambient[0] == ambient[1] && ambient[1] == ambient[2] && ambient[2] == ambient[3])
+					{
+						while (u + size.x < sizeU && faces_[u + size.x + v * sizeU] == face)
+							size.x++;
+
+						for (bool rowMatches = true; rowMatches && v + size.y < sizeV; )
+						{
+							for (int i = 0; i < size.x && rowMatches; i++)
+								rowMatches = faces_[u + i + (v + size.y) * sizeU] == face;
+
+							if (rowMatches)
+								size.y++;
+						}
+					}
+
+					// Consume merged faces
+					for (int j = 0; j < size.y; j++)
+					{
+						for (int i = 0; i < size.x; i++)
+							faces_[u + i + (v + j) * sizeU].exists = false;
+					}
+
+					glm::ivec3 pos;
+					pos[axis] = slice;
+					pos[axisU] = u;
+					pos[axisV] = v;
+					mesh.AddQuad(dir, pos, size, face.texture, face.occlusion.ambient, face.occlusion.flip);
+				}
+			}
+		}
+	}
+}
+
+bool ChunkMesher::Face::operator==(const Face &rhs) const
+{
+	return exists == rhs.exists && texture == rhs.texture &&
+		std::equal(std::begin(occlusion.ambient), std::end(occlusion.ambient), std::begin(rhs.occlusion.ambient));
+}
+
+unsigned ChunkMesher::TextureIndex(Block::BlockType type, Math::Direction dir)
+{
+	switch (dir)
+	{
+	case Math::DIRECTION_UP:
+		return BlockData::sideIndicies[type].top;
+	case Math::DIRECTION_DOWN:
+		return BlockData::sideIndicies[type].bottom;
+	default:
+		return BlockData::sideIndicies[type].side;
+	}
+}
+
+const ChunkMesher::Occlusion &ChunkMesher::GetOcclusion(glm::ivec3 adjacent, Math::Direction dir) const
+{
+	// Gather the ring of blocks around the face into one byte
+	const RingOffsets &offsets = GetRingOffsets()[dir];
+	size_t index = Index(adjacent);
+	unsigned ring = 0;
+	for (unsigned i = 0; i < ringSize; i++)
+		ring |= unsigned(blocks_[index + offsets[i]] != Block::BLOCK_AIR) << i;
+
+	return GetOcclusionTable()[ring];
+}
+
+const std::array<ChunkMesher::RingOffsets, Math::DIRECTION_COUNT> &ChunkMesher::GetRingOffsets()
+{
+	static const std::array<RingOffsets, Math::DIRECTION_COUNT> offsets = []()
+	{
+		std::array<RingOffsets, Math::DIRECTION_COUNT> offsets;
+		auto toOffset = [](glm::ivec3 vec) { return vec.x + vec.z * paddedSize + vec.y * paddedSize * paddedSize; };
+
+		for (int d = 0; d < Math::DIRECTION_COUNT; d++)
+		{
+			// Corners of the face
+			glm::ivec3 corners[Math::CORNER_COUNT];
+			for (int i = 0; i < Math::CORNER_COUNT; i++)
+			{
+				corners[i] = Math::CornerToVec(Math::Corner(i), Math::Direction(d));
+				offsets[d][i] = toOffset(corners[i]);
+			}
+
+			// Sides between two corners are where the corners agree
+			for (int i = 0; i < Math::CORNER_COUNT; i++)
+			{
+				glm::ivec3 a = corners[ringSides[i][0]];
+				glm::ivec3 b = corners[ringSides[i][1]];
+				offsets[d][Math::CORNER_COUNT + i] = toOffset(glm::ivec3(glm::equal(a, b)) * a);
+			}
+		}
+		return offsets;
+	}();
+
+	return offsets;
+}
+
+const std::array<ChunkMesher::Occlusion, 1 << ChunkMesher::ringSize> &ChunkMesher::GetOcclusionTable()
+{
+	static const std::array<Occlusion, 1 << ringSize> table = []()
+	{
+		std::array<Occlusion, 1 << ringSize> table;
+		for (unsigned ring = 0; ring < table.size(); ring++)
+		{
+			unsigned char *ambient = table[ring].ambient;
+			for (unsigned i = 0; i < Math::CORNER_COUNT; i++)
+			{
+				// Each corner touches the diagonal block and the two sides next to it
+				int corner = ring >> i & 1;
+				int sides = 0;
+				for (unsigned j = 0; j < Math::CORNER_COUNT; j++)
+				{
+					if (ringSides[j][0] == i || ringSides[j][1] == i)
+						sides += ring >> (Math::CORNER_COUNT + j) & 1;
+				}
+
+				if (sides == 2)
+					ambient[i] = 0; // max darkness
+				else
+					ambient[i] = 3 - (sides + corner); // darkness depends on which sides exist
+			}
+
+			// Flip quad if the ambient data needs a flipped quad to interpolate correctly
+			table[ring].flip = ambient[0] + ambient[3] > ambient[1] + ambient[2];
+		}
+		return table;
+	}();
+
+	return table;
+}
+
+size_t ChunkMesher::Index(glm::ivec3 pos) const
+{
+	return size_t(pos.x + 1) + size_t(pos.z + 1) * paddedSize + size_t(pos.y + 1) * paddedSize * paddedSize;
+}
+
+size_t ChunkMesher::RowIndex(int y, int z) const
+{
+	return size_t(z + 1) + size_t(y + 1) * paddedSize;
+}
+
+Block::BlockType ChunkMesher::GetBlock(glm::ivec3 pos) const
+{
+	return blocks_[Index(pos)];
+}
+
+bool ChunkMesher::SectionHidden(const Chunk &chunk, int section) const
+{
+	auto solid = [](const BlockStorage &storage) { return storage.IsUniform() && storage.GetUniform().type != Block::BLOCK_AIR; };
+
+	const BlockStorage &storage = chunk.GetSection(section);
+	if (!storage.IsUniform())
+		return false;
+
+	// Empty sections have no faces
+	if (storage.GetUniform().type == Block::BLOCK_AIR)
+		return true;
+
+	// Solid sections are hidden if enclosed by solid sections (bottom of world is never drawn)
+	if (section + 1 >= int(World::sectionCount) || !solid(chunk.GetSection(section + 1)))
+		return false;
+	if (section > 0 && !solid(chunk.GetSection(section - 1)))
+		return false;
+
+	for (int d = 0; d < Math::DIRECTION_COUNT; d++)
+	{
+		if (d == Math::DIRECTION_UP || d == Math::DIRECTION_DOWN)
+			continue;
+
+		const Chunk *neighbor = chunk.GetNeighbor(glm::ivec2(Math::directionVectors[d].x, Math::directionVectors[d].z));
+		if (neighbor == nullptr || !solid(neighbor->GetSection(section)))
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "WorldConstants.h"
+#include "Block.h"
+#include "Math.h"
+
+class Chunk;
+class ChunkMeshData;
+
+// Builds chunk meshes from a padded snapshot of a chunk and the borders of its neighbors
+//	Loading holds each source chunk's lock while copying, building never touches anything outside the snapshot
+//	Keep one mesher per thread to reuse its buffers
+class ChunkMesher
+{
+public:
+	// Snapshot width along x and z, one block of padding on each side
+	static const int paddedSize = World::chunkSize + 2;
+
+	// Copy the blocks needed to mesh a chunk into the snapshot and find its visible faces
+	void Load(const Chunk &chunk);
+
+	// Add the faces of the snapshot to a mesh, greedy merges equal neighboring faces into larger quads
+	void Build(ChunkMeshData &mesh, bool greedy = false);
+
+private:
+	// Ambient occlusion of a face's corners
+	struct Occlusion
+	{
+		unsigned char ambient[Math::CORNER_COUNT];
+		bool flip; // quad needs flipping to interpolate correctly
+	};
+
+	// Visible face in a slice
+	struct Face
+	{
+		bool exists;
+		unsigned char texture;
+		Occlusion occlusion;
+
+		bool operator==(const Face &rhs) const;
+	};
+
+	// Blocks around a face, low to high: corners in Math::Corner order, then the sides between ringSides
+	static const unsigned ringSize = 8;
+	static constexpr unsigned ringSides[Math::CORNER_COUNT][2] = { { 0, 1 }, { 1, 3 }, { 3, 2 }, { 2, 0 } };
+	typedef std::array<int, ringSize> RingOffsets; // snapshot index offsets from the block in front of a face
+
+	typedef uint32_t Row; // solid bits of a padded row, bit x + 1 is local x
+	typedef uint16_t FaceMask; // visible face bits of a row, bit x is local x
+
+	// low to high: x, z, y; coords offset by one so -1 is index 0
+	std::vector<Block::BlockType> blocks_;
+	std::vector<Row> solid_; // low to high: z, y; offset by one like blocks_
+	std::array<std::vector<FaceMask>, Math::DIRECTION_COUNT> visible_; // per direction, low to high: z, y
+	int top_ = -1; // highest local y that can have faces
+	std::array<bool, World::sectionCount> hiddenSections_ = {}; // sections without visible faces
+	std::vector<Face> faces_; // greedy meshing slice
+
+	size_t Index(glm::ivec3 pos) const; // snapshot index of a local coord
+	size_t RowIndex(int y, int z) const; // solid row index of a local coord
+	Block::BlockType GetBlock(glm::ivec3 pos) const; // block at a local coord
+	bool SectionHidden(const Chunk &chunk, int section) const; // can this section be skipped?
+	void CullFaces(); // find visible faces of every row with bitwise ops on solid rows
+	void BuildFaces(ChunkMeshData &mesh) const; // one quad per visible face
+	void BuildGreedy(ChunkMeshData &mesh); // merged quads per slice
+	static unsigned TextureIndex(Block::BlockType type, Math::Direction dir); // atlas index of a block side
+	const Occlusion &GetOcclusion(glm::ivec3 adjacent, Math::Direction dir) const; // corner occlusion of a face, looked up from its ring
+	static const std::array<RingOffsets, Math::DIRECTION_COUNT> &GetRingOffsets(); // ring offsets per face direction
+	static const std::array<Occlusion, 1 << ringSize> &GetOcclusionTable(); // occlusion of every ring
+};
@@ -0,0 +1,61 @@
+#include "ChunkPool.h"
+#include "Chunk.h"
+
+ChunkPool::ChunkPool(size_t capacity) : capacity_(capacity)
+{
+	free_.reserve(capacity);
+}
+
+Chunk *ChunkPool::Acquire(glm::ivec2 coord)
+{
+	Chunk *chunk;
+
+	if (!free_.empty())
+	{
+		// Reuse released chunk and its gpu objects
+		chunk = free_.back();
+		free_.pop_back();
+		chunk->Reset(coord);
+		stats_.hits++;
+	}
+	else
+	{
+		chunk = new Chunk(coord);
+		stats_.misses++;
+	}
+
+	stats_.inUse++;
+	stats_.peak = glm::max(stats_.peak, stats_.inUse);
+	return chunk;
+}
+
+void ChunkPool::Release(Chunk *chunk)
+{
+	stats_.inUse--;
+
+	if (free_.size() < capacity_)
+		free_.push_back(chunk);
+	else
+		delete chunk;
+}
+
+const ChunkPool::Stats &ChunkPool::GetStats() const
+{
+	return stats_;
+}
+
+size_t ChunkPool::GetCapacity() const
+{
+	return capacity_;
+}
+
+size_t ChunkPool::GetFreeCount() const
+{
+	return free_.size();
+}
+
+ChunkPool::~ChunkPool()
+{
+	for (Chunk *chunk : free_)
+		delete chunk;
+}
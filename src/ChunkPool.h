@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+class Chunk;
+
+// Recycles chunks and their gpu buffers instead of allocating per load
+class ChunkPool
+{
+public:
+	// Usage counters
+	struct Stats
+	{
+		size_t hits = 0; // acquires served from the free list
+		size_t misses = 0; // acquires that allocated a new chunk
+		size_t inUse = 0; // chunks currently acquired
+		size_t peak = 0; // highest inUse reached
+	};
+
+	// Keeps at most capacity released chunks for reuse
+	ChunkPool(size_t capacity);
+
+	// Get an empty chunk at the given coord
+	Chunk *Acquire(glm::ivec2 coord);
+
+	// Return a chunk to the pool, deleting it if the pool is full
+	void Release(Chunk *chunk);
+
+	// Get info
+	const Stats &GetStats() const;
+	size_t GetCapacity() const;
+	size_t GetFreeCount() const;
+
+	~ChunkPool();
+
+private:
+	size_t capacity_;
+	std::vector<Chunk *> free_;
+	Stats stats_;
+
+public: // Pool owns chunks, disallow copies
+	ChunkPool(ChunkPool const &) = delete;
+	void operator=(ChunkPool const &) = delete;
+};
@@ -0,0 +1,99 @@
+#include "ChunkScheduler.h"
+
+#include <algorithm>
+#include <iterator>
+
+ChunkScheduler::ChunkScheduler(float budget, float queueTime) : budget_(budget), queueTime_(queueTime), stats_()
+{
+	// Rough guesses until the first measurements
+	cost_[OPERATION_GENERATE] = 0.002f;
+	cost_[OPERATION_MESH] = 0.001f;
+	cost_[OPERATION_INSERT] = 0.00001f;
+	cost_[OPERATION_UPLOAD] = 0.0001f;
+
+	std::fill(std::begin(measured_), std::end(measured_), false);
+	std::copy(std::begin(cost_), std::end(cost_), std::begin(stats_.cost));
+
+	stats_.budget = budget_;
+}
+
+void ChunkScheduler::BeginFrame()
+{
+	stats_.deferred = 0;
+	stats_.spent = 0.0f;
+	std::fill(std::begin(stats_.completed), std::end(stats_.completed), size_t(0));
+}
+
+bool ChunkScheduler::CanRun(Operation operation) const
+{
+	size_t ran = stats_.completed[OPERATION_INSERT] + stats_.completed[OPERATION_UPLOAD];
+	return ran == 0 || stats_.spent + cost_[operation] <= budget_;
+}
+
+void ChunkScheduler::Record(Operation operation, float seconds)
+{
+	// First measurement replaces the guess
+	if (measured_[operation])
+		cost_[operation] += (seconds - cost_[operation]) * costSmoothing;
+	else
+		cost_[operation] = seconds;
+	measured_[operation] = true;
+
+	stats_.cost[operation] = cost_[operation];
+	stats_.completed[operation]++;
+
+	if (OnMainThread(operation))
+		stats_.spent += seconds;
+}
+
+void ChunkScheduler::SetQueue(size_t queuedJobs, size_t pending)
+{
+	stats_.queuedJobs = queuedJobs;
+	stats_.pending = pending;
+}
+
+void ChunkScheduler::Defer(size_t count)
+{
+	stats_.deferred += count;
+}
+
+size_t ChunkScheduler::MaxQueuedJobs(unsigned workers)
+{
+	// Cheap jobs need a deeper queue to cover the same time, but too deep and priorities go stale while moving
+	float jobCost = (cost_[OPERATION_GENERATE] + cost_[OPERATION_MESH]) * 0.5f;
+	size_t perWorker = std::clamp(size_t(queueTime_ / std::max(jobCost, 1e-6f)), size_t(1), size_t(16));
+
+	stats_.maxQueuedJobs = perWorker * workers;
+	return stats_.maxQueuedJobs;
+}
+
+void ChunkScheduler::SetBudget(float seconds)
+{
+	budget_ = std::max(seconds, 0.0f);
+	stats_.budget = budget_;
+}
+
+float ChunkScheduler::GetBudget() const
+{
+	return budget_;
+}
+
+float ChunkScheduler::GetCost(Operation operation) const
+{
+	return cost_[operation];
+}
+
+float ChunkScheduler::GetRemaining() const
+{
+	return std::max(budget_ - stats_.spent, 0.0f);
+}
+
+const ChunkScheduler::Stats &ChunkScheduler::GetStats() const
+{
+	return stats_;
+}
+
+bool ChunkScheduler::OnMainThread(Operation operation)
+{
+	return operation == OPERATION_INSERT || operation == OPERATION_UPLOAD;
+}
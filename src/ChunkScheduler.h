@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+
+// Spends a per-frame time budget on chunk work, deferring what doesn't fit to later frames
+//	Costs of each operation are measured as they run, so the amount taken per frame follows the hardware
+class ChunkScheduler
+{
+public:
+	// Measured operations, generation and meshing run on workers while the rest take main thread time
+	enum Operation
+	{
+		OPERATION_GENERATE, // generate blocks of a chunk
+		OPERATION_MESH, // build mesh data of a chunk
+		OPERATION_INSERT, // add a generated chunk to the world
+		OPERATION_UPLOAD, // send built mesh data to the gpu
+
+		OPERATION_COUNT
+	};
+
+	// Counters of the current frame, costs are averages
+	struct Stats
+	{
+		size_t queuedJobs; // jobs waiting for a worker
+		size_t maxQueuedJobs; // queue depth the job costs allow
+		size_t pending; // finished results waiting for main thread time
+		size_t deferred; // results left over when the budget ran out
+		size_t completed[OPERATION_COUNT];
+		float cost[OPERATION_COUNT]; // seconds
+		float spent; // seconds of main thread time used
+		float budget;
+	};
+
+	// Budget in seconds of main thread time per frame, queue time in seconds of work per worker
+	ChunkScheduler(float budget, float queueTime);
+
+	// Reset frame counters and start the frame's budget
+	void BeginFrame();
+
+	// If a main thread operation fits in what's left of the budget, the first of a frame always fits so work never stalls
+	bool CanRun(Operation operation) const;
+
+	// Add a measured operation, main thread operations are taken from the budget
+	void Record(Operation operation, float seconds);
+
+	// Update queue counters
+	void SetQueue(size_t queuedJobs, size_t pending);
+	void Defer(size_t count);
+
+	// Most background jobs to keep queued so workers stay busy for the queue time
+	size_t MaxQueuedJobs(unsigned workers);
+
+	// Settings
+	void SetBudget(float seconds);
+	float GetBudget() const;
+
+	// Get info
+	float GetCost(Operation operation) const; // seconds, estimated until measured
+	float GetRemaining() const; // seconds of budget left this frame
+	const Stats &GetStats() const;
+
+private:
+	// Weight of new measurements in the cost averages
+	static constexpr float costSmoothing = 0.1f;
+
+	float budget_;
+	float queueTime_; // seconds of estimated work to keep queued per worker
+	float cost_[OPERATION_COUNT];
+	bool measured_[OPERATION_COUNT];
+	Stats stats_;
+
+	static bool OnMainThread(Operation operation);
+};
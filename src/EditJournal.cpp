@@ -0,0 +1,294 @@
+#include "EditJournal.h"
+#include "WorldConstants.h"
+#include "FileSync.h"
+
+#include <filesystem>
+#include <algorithm>
+
+// Records added this soon after the first one of a group share its commit
+static const std::chrono::milliseconds groupWindow(2);
+
+// Wait after a failed compaction before trying again
+static const std::chrono::milliseconds retryDelay(100);
+
+EditJournal::EditJournal(const std::string &directory, const std::string &name) :
+	directory_(directory),
+	path_(directory + "/" + name),
+	file_(nullptr),
+	compactQueued_(false),
+	writing_(false),
+	stopping_(false)
+{
+	Load();
+	thread_ = std::thread(&EditJournal::Run, this);
+}
+
+void EditJournal::Record(glm::ivec2 coord, glm::ivec3 local, const Block &block)
+{
+	FileRecord record = { coord.x, coord.y, uint16_t(local.x + local.z * World::chunkSize + local.y * World::chunkArea), block.type, 0 };
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		Apply(record);
+		if (queued_.empty())
+			oldestQueued_ = Clock::now();
+		queued_.push_back(record);
+		stats_.pending = queued_.size();
+	}
+	wake_.notify_one();
+}
+
+bool EditJournal::GetEdits(glm::ivec2 coord, std::vector<Edit> &edits) const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto found = edits_.find(coord);
+	if (found == edits_.end())
+		return false;
+
+	edits.clear();
+	for (const LocalEdit &edit : found->second)
+	{
+		glm::ivec3 local = { edit.index % World::chunkSize, edit.index / World::chunkArea, edit.index / World::chunkSize % World::chunkSize };
+		edits.push_back({ local, edit.block });
+	}
+	return true;
+}
+
+void EditJournal::Flush()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	idle_.wait(lock, [this]() { return queued_.empty() && !compactQueued_ && !writing_; });
+}
+
+EditJournal::Stats EditJournal::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return stats_;
+}
+
+EditJournal::~EditJournal()
+{
+	// The thread writes what's queued before it stops
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopping_ = true;
+	}
+	wake_.notify_all();
+	thread_.join();
+
+	if (file_ != nullptr)
+		std::fclose(file_);
+}
+
+void EditJournal::Load()
+{
+	FILE *file = std::fopen(path_.c_str(), "rb");
+	if (file == nullptr)
+		return;
+
+	// Anything that isn't a journal is rewritten, as if it were empty
+	uint32_t header[2];
+	if (std::fread(header, sizeof(header), 1, file) != 1 || header[0] != magic || header[1] != version)
+	{
+		std::fclose(file);
+		compactQueued_ = true;
+		return;
+	}
+
+	// Later records replace earlier ones for the same block
+	FileRecord record;
+	while (std::fread(&record, sizeof(record), 1, file) == 1)
+	{
+		if (record.index >= World::chunkVolume || record.type >= Block::BLOCK_COUNT)
+			break;
+
+		Apply(record);
+		stats_.records++;
+	}
+
+	// A partial record at the end is left by a crash during an append, appending after it would misalign the rest
+	std::fseek(file, 0, SEEK_END);
+	stats_.fileBytes = size_t(std::ftell(file));
+	if (stats_.fileBytes != headerSize + stats_.records * sizeof(FileRecord))
+		compactQueued_ = true;
+	std::fclose(file);
+
+	if (stats_.records >= compactMinimum && stats_.records > stats_.edits * compactRatio)
+		compactQueued_ = true;
+}
+
+void EditJournal::Apply(const FileRecord &record)
+{
+	std::vector<LocalEdit> &edits = edits_[{ record.x, record.z }];
+	if (edits.empty())
+		stats_.chunks++;
+
+	// Only the newest edit of a block matters
+	Block block = { Block::BlockType(record.type) };
+	for (LocalEdit &edit : edits)
+	{
+		if (edit.index == record.index)
+		{
+			edit.block = block;
+			return;
+		}
+	}
+
+	edits.push_back({ record.index, block });
+	stats_.edits++;
+}
+
+void EditJournal::Run()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	while (true)
+	{
+		wake_.wait(lock, [this]() { return stopping_ || !queued_.empty() || compactQueued_; });
+		if (queued_.empty() && !compactQueued_)
+			return;
+
+		writing_ = true;
+		if (compactQueued_)
+		{
+			// Snapshot every live edit, queued records are already in it
+			std::vector<FileRecord> records;
+			records.reserve(stats_.edits);
+			for (const auto &chunk : edits_)
+			{
+				for (const LocalEdit &edit : chunk.second)
+					records.push_back({ chunk.first.x, chunk.first.y, edit.index, edit.block.type, 0 });
+			}
+			queued_.clear();
+			compactQueued_ = false;
+
+			lock.unlock();
+			bool written = Compact(records);
+			lock.lock();
+
+			if (written)
+			{
+				stats_.records = records.size();
+				stats_.compactions++;
+			}
+			else
+			{
+				stats_.failures++;
+
+				// Try again after a wait, nothing is left to retry with once stopping
+				wake_.wait_for(lock, retryDelay, [this]() { return stopping_; });
+				compactQueued_ = !stopping_;
+			}
+		}
+		else
+		{
+			// Give more edits a chance to share the commit, one sync costs about the same for any group size
+			wake_.wait_until(lock, oldestQueued_ + groupWindow, [this]() { return stopping_; });
+
+			// Swap out so edits can keep queuing while these are written
+			std::vector<FileRecord> records;
+			records.swap(queued_);
+
+			lock.unlock();
+			bool written = Append(records);
+			lock.lock();
+
+			if (written)
+			{
+				stats_.records += records.size();
+				stats_.commits++;
+			}
+			else
+			{
+				// The group is still in edits_, rewriting from it also drops any partial record
+				stats_.failures++;
+				compactQueued_ = true;
+			}
+
+			if (stats_.records >= compactMinimum && stats_.records > stats_.edits * compactRatio)
+				compactQueued_ = true;
+		}
+
+		stats_.fileBytes = headerSize + stats_.records * sizeof(FileRecord);
+		stats_.pending = queued_.size();
+		writing_ = false;
+
+		if (queued_.empty() && !compactQueued_)
+			idle_.notify_all();
+	}
+}
+
+bool EditJournal::Append(const std::vector<FileRecord> &records)
+{
+	if (file_ == nullptr && !OpenFile())
+		return false;
+
+	// Synced per group, a crash loses at most the group being written
+	bool written = std::fwrite(records.data(), sizeof(FileRecord), records.size(), file_) == records.size();
+	written = SyncFile(file_) && written;
+
+	// Reopened by the compaction that follows a failure
+	if (!written)
+	{
+		std::fclose(file_);
+		file_ = nullptr;
+	}
+	return written;
+}
+
+bool EditJournal::Compact(const std::vector<FileRecord> &records)
+{
+	if (file_ != nullptr)
+	{
+		std::fclose(file_);
+		file_ = nullptr;
+	}
+
+	// Written beside the journal then swapped in, so a crash keeps one complete copy
+	std::string temporary = path_ + ".tmp";
+	FILE *file = std::fopen(temporary.c_str(), "wb");
+	if (file == nullptr)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(directory_, error);
+		file = std::fopen(temporary.c_str(), "wb");
+		if (file == nullptr)
+			return false;
+	}
+
+	// On disk before the rename, otherwise a crash could swap in an empty or partial file
+	uint32_t header[2] = { magic, version };
+	bool written =
+		std::fwrite(header, sizeof(header), 1, file) == 1 &&
+		std::fwrite(records.data(), sizeof(FileRecord), records.size(), file) == records.size() &&
+		SyncFile(file);
+	written = std::fclose(file) == 0 && written;
+
+	std::error_code error;
+	if (written)
+		std::filesystem::rename(temporary, path_, error);
+
+	return written && !error && OpenFile();
+}
+
+bool EditJournal::OpenFile()
+{
+	file_ = std::fopen(path_.c_str(), "ab");
+	if (file_ == nullptr)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(directory_, error);
+		file_ = std::fopen(path_.c_str(), "ab");
+		if (file_ == nullptr)
+			return false;
+	}
+
+	// New files start with the header
+	std::fseek(file_, 0, SEEK_END);
+	if (std::ftell(file_) == 0)
+	{
+		uint32_t header[2] = { magic, version };
+		if (std::fwrite(header, sizeof(header), 1, file_) != 1)
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+
+#include "Block.h"
+
+// Append-only log of block edits, replayed over generated terrain instead of saving whole chunks
+//	Every edit stays in memory; a background thread appends new ones in groups with one disk sync each, and compacts the file once most records are stale
+class EditJournal
+{
+public:
+	// Block changed inside a chunk
+	struct Edit
+	{
+		glm::ivec3 local; // block coord within the chunk
+		Block block;
+	};
+
+	// Usage counters
+	struct Stats
+	{
+		size_t edits = 0; // live edits, the newest one per block
+		size_t chunks = 0; // chunks with edits
+		size_t records = 0; // records in the file, stale ones included
+		size_t fileBytes = 0;
+		size_t pending = 0; // records waiting to be appended
+		size_t commits = 0; // disk syncs, each covers a group of records
+		size_t compactions = 0;
+		size_t failures = 0; // writes that didn't make it to disk
+	};
+
+	// Reads the journal file in the directory if there is one, otherwise it's created by the first write
+	EditJournal(const std::string &directory, const std::string &name);
+
+	// Remember a block edit to a chunk and queue it to be appended
+	void Record(glm::ivec2 coord, glm::ivec3 local, const Block &block);
+
+	// Get the edits of a chunk in the order they should be applied, false if it has none
+	bool GetEdits(glm::ivec2 coord, std::vector<Edit> &edits) const;
+
+	// Wait until every queued record is written
+	void Flush();
+
+	// Get info
+	Stats GetStats() const;
+
+	// Write what's queued, then stop; records that still fail to write are lost
+	~EditJournal();
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	// Record as stored in the file
+	struct FileRecord
+	{
+		int32_t x; // chunk coord
+		int32_t z;
+		uint16_t index; // local block, x + z * size + y * area
+		uint8_t type;
+		uint8_t padding;
+	};
+
+	// Edit inside a chunk
+	struct LocalEdit
+	{
+		uint16_t index;
+		Block block;
+	};
+
+	static const uint32_t magic = 0x4A455856; // "VXEJ"
+	static const uint32_t version = 1;
+	static const size_t headerSize = sizeof(uint32_t) * 2;
+
+	// Compact once stale records outnumber live ones by this much, and there are at least this many records
+	static const size_t compactRatio = 2;
+	static const size_t compactMinimum = 4096;
+
+	std::string directory_;
+	std::string path_;
+	FILE *file_; // open for appending, save thread only
+
+	mutable std::mutex mutex_; // guards everything below
+	std::condition_variable wake_;
+	std::condition_variable idle_;
+	std::unordered_map<glm::ivec2, std::vector<LocalEdit>> edits_;
+	std::vector<FileRecord> queued_; // oldest first
+	Clock::time_point oldestQueued_; // when the first queued record was added
+	bool compactQueued_; // file needs rewriting, it has stale or torn records
+	bool writing_;
+	bool stopping_;
+	Stats stats_;
+	std::thread thread_;
+
+	void Load(); // read the file into edits_
+	void Apply(const FileRecord &record); // replace the chunk's edit of the same block, lock held
+	void Run(); // save thread loop
+	bool Append(const std::vector<FileRecord> &records); // append and sync to disk
+	bool Compact(const std::vector<FileRecord> &records); // rewrite the file with only these records
+	bool OpenFile(); // open for appending, creating the file and directory if needed
+
+public: // Thread references the journal, disallow copies
+	EditJournal(EditJournal const &) = delete;
+	void operator=(EditJournal const &) = delete;
+};
@@ -0,0 +1,6 @@
+#pragma once
+
+#include <cstdio>
+
+// Write a file's buffered data through the os cache to the disk, false if it didn't make it
+bool SyncFile(FILE *file);
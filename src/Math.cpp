@@ -1,6 +1,10 @@
 #include "Math.h"
 #include "Mesh.h"
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 Math::Direction Math::AxisToDir(Axis axis, bool negative)
 {
 	return Math::Direction(axis * 2 + (negative ? 1 : 0));
@@ -47,6 +51,17 @@ int Math::PositiveMod(int val, int mod)
 	return (mod * ((-val / mod) + 1)) + val - 1;
 }
 
+unsigned Math::CountTrailingZeros(uint32_t value)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, value);
+	return unsigned(index);
+#else
+	return unsigned(__builtin_ctz(value));
+#endif
+}
+
 glm::vec2 Math::GetUVFromSheet(unsigned sizeX, unsigned sizeY, unsigned index, Corner corner)
 {
 	unsigned column = index % sizeX;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cmath>
+#include <cstdint>
 #include <glm/glm.hpp>
 #include <glm/gtx/norm.hpp>
 #include <glm/gtx/compatibility.hpp>
@@ -85,6 +86,9 @@ namespace Math
 	float PositiveMod(float val, float mod);
 	int PositiveMod(int val, int mod);
 
+	// Index of the lowest set bit, value must not be zero
+	unsigned CountTrailingZeros(uint32_t value);
+
 	// Get UV coordinates from a sprite sheet
 	glm::vec2 GetUVFromSheet(unsigned sizeX, unsigned sizeY, unsigned index, Corner corner);
 
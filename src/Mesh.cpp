@@ -54,8 +54,19 @@ const Vertex Mesh::quads[Math::DIRECTION_COUNT][Math::CORNER_COUNT] =
 	},
 };
 
+// Axes that uv x and y run along in above vertices
+const Math::Axis Mesh::quadAxes[Math::DIRECTION_COUNT][2] =
+{
+	{ Math::AXIS_Z, Math::AXIS_Y }, // QUAD_LEFT
+	{ Math::AXIS_Z, Math::AXIS_Y }, // QUAD_RIGHT
+	{ Math::AXIS_X, Math::AXIS_Z }, // QUAD_TOP
+	{ Math::AXIS_X, Math::AXIS_Z }, // QUAD_BOTTOM
+	{ Math::AXIS_X, Math::AXIS_Y }, // QUAD_FRONT
+	{ Math::AXIS_X, Math::AXIS_Y }, // QUAD_BACK
+};
+
 // Indices for above vertices
-const unsigned Mesh::quadIndices[] = { 0, 1, 2, 2, 1, 3 };
+const unsigned Mesh::quadIndices[6] = { 0, 1, 2, 2, 1, 3 };
 
 Mesh::Mesh(size_t reserve)
 {
@@ -137,17 +148,22 @@ Mesh Mesh::CreateCube(float size)
 	);
 }
 
-void Mesh::AddQuad(Math::Direction orientation, glm::vec3 offset, float uvScale, glm::vec2 uvOffset, unsigned char ambients[])
+void Mesh::AddQuad(Math::Direction orientation, glm::vec3 offset, glm::vec2 size, float uvScale, glm::vec2 uvOffset, const unsigned char ambients[], bool flip)
 {
 	// Insert base quad
 	vertices_.insert(vertices_.end(), &quads[orientation][0], &quads[orientation][Math::CORNER_COUNT]);
 	onCpu_ = true;
+
+	// Scale along the quad's axes
+	glm::vec3 scale = glm::vec3(1.0f);
+	scale[quadAxes[orientation][0]] = size.x;
+	scale[quadAxes[orientation][1]] = size.y;
 	
 	// Transform quad data by parameters given
 	for (size_t i = 0; i < Math::CORNER_COUNT; i++)
 	{
 		size_t current = vertices_.size() - (Math::CORNER_COUNT - i);
-		vertices_[current].position += offset;
+		vertices_[current].position = vertices_[current].position * scale + offset;
 
 		vertices_[current].uv *= uvScale;
 		vertices_[current].uv += uvOffset;
@@ -156,8 +172,8 @@ void Mesh::AddQuad(Math::Direction orientation, glm::vec3 offset, float uvScale,
 			vertices_[current].ambient = ambients[i];
 	}
 
-	// Flip quad if the ambient data needs a flipped quad to interpolate correctly
-	if (ambients != nullptr && ambients[0] + ambients[3] > ambients[1] + ambients[2])
+	// Flip quad to split along the other diagonal
+	if (flip)
 	{
 		std::swap(*(vertices_.end() - 4), *(vertices_.end() - 2));
 		std::swap(*(vertices_.end() - 3), *(vertices_.end() - 1));
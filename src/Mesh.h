@@ -32,13 +32,15 @@ public:
 	// Create a cube mesh at origin with size*size*size dimensions
 	static Mesh CreateCube(float size);
 
-	// Add a quad manually
+	// Add a quad manually, size stretches the quad along its axes
 	void AddQuad(
 		Math::Direction orientation,
 		glm::vec3 offset = glm::vec3(0.0f, 0.0f, 0.0f),
+		glm::vec2 size = glm::vec2(1.0f, 1.0f),
 		float uvScale = 1.0f,
 		glm::vec2 uvOffset = glm::vec2(0.0f, 0.0f),
-		unsigned char ambients[] = nullptr
+		const unsigned char ambients[] = nullptr,
+		bool flip = false // reverse the diagonal so ambient occlusion interpolates correctly
 	);
 
 	// Set mesh data
@@ -61,7 +63,10 @@ public:
 
 	static const Vertex quads[Math::DIRECTION_COUNT][Math::CORNER_COUNT];
 
-	static const unsigned quadIndices[];
+	// Axes of quad uv x and y for each direction
+	static const Math::Axis quadAxes[Math::DIRECTION_COUNT][2];
+
+	static const unsigned quadIndices[6];
 private:
 	GLuint vbo_;
 	GLuint vao_;
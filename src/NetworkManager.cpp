@@ -71,6 +71,7 @@ void NetworkManager::Render(Shader &shader)
 		return;
 
 	shader.Use();
+	shader.SetVar("packedVertices", false);
 	headTexture_.Activate(GL_TEXTURE0);
 
 	// Render each player
@@ -53,6 +53,56 @@ void Player::Update(float dt)
 	if (input.GetKeyPressed(GLFW_KEY_F4))
 		fastPlace = !fastPlace;
 
+	// Greedy meshing
+	if (input.GetKeyPressed(GLFW_KEY_F5))
+		chunk.SetGreedyMeshing(!chunk.GetGreedyMeshing());
+
+	// Chunk scheduler, prefetch, cache, storage, and memory counters
+	if (input.GetKeyPressed(GLFW_KEY_F6))
+	{
+		const ChunkScheduler::Stats &stats = chunk.GetSchedulerStats();
+		std::cout << "Chunk jobs queued: " << stats.queuedJobs << "/" << stats.maxQueuedJobs
+			<< ", pending: " << stats.pending << ", deferred: " << stats.deferred
+			<< ", frame: " << stats.spent * 1000.0f << "/" << stats.budget * 1000.0f << " ms" << std::endl;
+		std::cout << "Chunk costs: generate " << stats.cost[ChunkScheduler::OPERATION_GENERATE] * 1000.0f
+			<< " ms, mesh " << stats.cost[ChunkScheduler::OPERATION_MESH] * 1000.0f
+			<< " ms, insert " << stats.cost[ChunkScheduler::OPERATION_INSERT] * 1000.0f
+			<< " ms, upload " << stats.cost[ChunkScheduler::OPERATION_UPLOAD] * 1000.0f << " ms" << std::endl;
+
+		const ChunkManager::PrefetchStats &prefetch = chunk.GetPrefetchStats();
+		size_t finished = prefetch.hits + prefetch.misses;
+		std::cout << "Chunk prefetch: " << prefetch.queued << " queued, " << prefetch.hits << " hits, " << prefetch.misses << " misses ("
+			<< (finished != 0 ? 100.0f * prefetch.hits / finished : 0.0f) << "% hit rate)" << std::endl;
+
+		const ChunkCache::Stats &cache = chunk.GetCacheStats();
+		std::cout << "Chunk cache: " << cache.entries << " chunks, " << cache.bytes / 1024 << " KiB, " << cache.hits << " hits, "
+			<< cache.misses << " misses, " << cache.evictions << " evictions" << std::endl;
+
+		WorldStorage::Stats storage = chunk.GetStorageStats();
+		std::cout << "Chunk storage: " << storage.loads << " loaded, " << storage.saves << " saved, " << storage.pending << " pending, "
+			<< storage.failures << " failed, " << storage.bytesRead / 1024 << " KiB read, " << storage.bytesWritten / 1024 << " KiB written" << std::endl;
+
+		if (World::saveEditJournal)
+		{
+			EditJournal::Stats journal = chunk.GetJournalStats();
+			std::cout << "Edit journal: " << journal.edits << " edits in " << journal.chunks << " chunks, " << journal.records << " records ("
+				<< journal.fileBytes / 1024 << " KiB), " << journal.pending << " pending, " << journal.commits << " syncs, " << journal.compactions << " compactions, "
+				<< journal.failures << " failed" << std::endl;
+		}
+		else
+		{
+			WriteAheadLog::Stats log = chunk.GetLogStats();
+			std::cout << "Edit log: " << log.committed << "/" << log.appended << " edits committed in " << log.commits << " syncs, " << log.throughput << " edits/s, latency "
+				<< log.latency * 1000.0f << " ms (max " << log.maxLatency * 1000.0f << " ms), " << log.dirtyChunks << " chunks to checkpoint, "
+				<< log.logBytes / 1024 << " KiB, " << log.rewrites << " rewrites, " << log.failures << " failed" << std::endl;
+		}
+
+		const ChunkManager::MemoryStats &memory = chunk.GetMemoryStats();
+		std::cout << "Chunk memory: blocks " << (memory.chunkBytes + memory.cacheBytes) / (1024 * 1024) << "/" << memory.chunkCap / (1024 * 1024)
+			<< " MiB (" << memory.cacheBytes / (1024 * 1024) << " cached), meshes " << memory.meshBytes / (1024 * 1024) << "/" << memory.meshCap / (1024 * 1024)
+			<< " MiB, render distance " << memory.renderDistance << std::endl;
+	}
+
 	// Build
 	bool placing = fastPlace ? input.GetKey(GLFW_MOUSE_BUTTON_RIGHT) : input.GetKeyPressed(GLFW_MOUSE_BUTTON_RIGHT);
 	bool destroying = fastPlace ? input.GetKey(GLFW_MOUSE_BUTTON_LEFT) : input.GetKeyPressed(GLFW_MOUSE_BUTTON_LEFT);
@@ -0,0 +1,281 @@
+#include "RegionFile.h"
+#include "FileSync.h"
+
+#include <cstring>
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+RegionFile::RegionFile(const std::string &path) : path_(path), exists_(false), fileSize_(0), freeKnown_(false), view_(nullptr), viewSize_(0), mapping_(nullptr)
+{
+	FILE *file = std::fopen(path_.c_str(), "rb");
+	if (file != nullptr)
+	{
+		std::fseek(file, 0, SEEK_END);
+		fileSize_ = size_t(std::ftell(file));
+		std::fclose(file);
+		exists_ = fileSize_ >= headerSize;
+	}
+}
+
+bool RegionFile::Read(int x, int z, std::vector<unsigned char> &out)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (!exists_ || (view_ == nullptr && !Map()))
+		return false;
+
+	Slot slot;
+	if (!ReadSlot(x + z * regionSize, slot) || slot.offset == 0 || size_t(slot.offset) + slot.size > viewSize_)
+		return false;
+
+	// Copying touches only the blob's pages
+	out.assign(view_ + slot.offset, view_ + slot.offset + slot.size);
+	return true;
+}
+
+bool RegionFile::Write(int x, int z, const unsigned char *data, size_t size)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	// Writing while mapped isn't portable, the next read maps again
+	Unmap();
+
+	FILE *file = std::fopen(path_.c_str(), exists_ ? "r+b" : "w+b");
+	if (file == nullptr)
+		return false;
+
+	// New files start with an empty header, on disk before anything relies on it
+	if (!exists_)
+	{
+		std::vector<unsigned char> header(headerSize, 0);
+		uint32_t start[2] = { magic, version };
+		std::memcpy(header.data(), start, sizeof(start));
+		if (std::fwrite(header.data(), 1, header.size(), file) != header.size() || !SyncFile(file))
+		{
+			std::fclose(file);
+			std::remove(path_.c_str());
+			return false;
+		}
+		fileSize_ = headerSize;
+		exists_ = true;
+	}
+
+	if (!freeKnown_)
+		FindFreeSpace(file);
+
+	int index = x + z * regionSize;
+	long slotOffset = long(sizeof(uint32_t) * 2 + sizeof(Slot) * index);
+
+	Slot old = {};
+	std::fseek(file, slotOffset, SEEK_SET);
+	if (std::fread(&old, sizeof(old), 1, file) != 1)
+		old = {};
+
+	// Never over the old blob, a torn write there would lose the chunk
+	Slot slot = { AllocateSpace(size), uint32_t(size) };
+
+	// Blob first and on disk, so neither a failed write nor a crash leaves the table pointing at garbage
+	std::fseek(file, long(slot.offset), SEEK_SET);
+	bool written = std::fwrite(data, 1, size, file) == size && SyncFile(file);
+	if (written)
+	{
+		fileSize_ = std::max(fileSize_, size_t(slot.offset) + size);
+
+		std::fseek(file, slotOffset, SEEK_SET);
+		written = std::fwrite(&slot, sizeof(slot), 1, file) == 1 && SyncFile(file);
+
+		// A failed table write may still have landed, keep both blobs until the next open finds which is free
+		if (written && old.offset != 0)
+			ReleaseSpace(old);
+	}
+	else if (size_t(slot.offset) + size <= fileSize_)
+	{
+		// The table never saw this space
+		ReleaseSpace(slot);
+	}
+
+	return std::fclose(file) == 0 && written;
+}
+
+bool RegionFile::Exists() const
+{
+	return exists_;
+}
+
+size_t RegionFile::GetFileSize() const
+{
+	return fileSize_;
+}
+
+RegionFile::~RegionFile()
+{
+	Unmap();
+}
+
+bool RegionFile::Map()
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path_.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	GetFileSizeEx(file, &size);
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file); // mapping keeps the file open
+
+	if (mapping == nullptr)
+		return false;
+
+	view_ = static_cast<const unsigned char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (view_ == nullptr)
+	{
+		CloseHandle(mapping);
+		return false;
+	}
+
+	mapping_ = mapping;
+	viewSize_ = size_t(size.QuadPart);
+#else
+	int file = open(path_.c_str(), O_RDONLY);
+	if (file < 0)
+		return false;
+
+	struct stat info;
+	fstat(file, &info);
+	void *view = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_SHARED, file, 0);
+	close(file); // mapping keeps the file open
+
+	if (view == MAP_FAILED)
+		return false;
+
+	view_ = static_cast<const unsigned char *>(view);
+	viewSize_ = size_t(info.st_size);
+#endif
+
+	// Not a region file, treat it as missing
+	uint32_t start[2];
+	if (viewSize_ < headerSize || (std::memcpy(start, view_, sizeof(start)), start[0] != magic || start[1] != version))
+	{
+		Unmap();
+		exists_ = false;
+		return false;
+	}
+
+	return true;
+}
+
+void RegionFile::Unmap()
+{
+	if (view_ == nullptr)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(view_);
+	CloseHandle(static_cast<HANDLE>(mapping_));
+#else
+	munmap(const_cast<unsigned char *>(view_), viewSize_);
+#endif
+
+	view_ = nullptr;
+	viewSize_ = 0;
+	mapping_ = nullptr;
+}
+
+bool RegionFile::ReadSlot(int index, Slot &slot)
+{
+	if (index < 0 || index >= chunkCount)
+		return false;
+
+	std::memcpy(&slot, view_ + sizeof(uint32_t) * 2 + sizeof(Slot) * index, sizeof(slot));
+	return true;
+}
+
+void RegionFile::FindFreeSpace(FILE *file)
+{
+	freeKnown_ = true;
+	free_.clear();
+
+	std::vector<Slot> slots(chunkCount);
+	std::fseek(file, long(sizeof(uint32_t) * 2), SEEK_SET);
+	if (std::fread(slots.data(), sizeof(Slot), slots.size(), file) != slots.size())
+		return;
+
+	// Walk the blobs in file order, anything between them was left by replaced or torn writes
+	slots.erase(std::remove_if(slots.begin(), slots.end(), [](const Slot &slot) { return slot.offset == 0; }), slots.end());
+	std::sort(slots.begin(), slots.end(), [](const Slot &lhs, const Slot &rhs) { return lhs.offset < rhs.offset; });
+
+	size_t end = headerSize;
+	for (const Slot &slot : slots)
+	{
+		if (slot.offset > end)
+			free_.push_back({ uint32_t(end), uint32_t(slot.offset - end) });
+		end = std::max(end, size_t(slot.offset) + slot.size);
+	}
+
+	if (fileSize_ > end)
+		free_.push_back({ uint32_t(end), uint32_t(fileSize_ - end) });
+}
+
+uint32_t RegionFile::AllocateSpace(size_t size)
+{
+	// First gap that fits
+	for (size_t i = 0; i < free_.size(); i++)
+	{
+		Slot &space = free_[i];
+		if (space.size < size)
+			continue;
+
+		uint32_t offset = space.offset;
+		space.offset += uint32_t(size);
+		space.size -= uint32_t(size);
+		if (space.size == 0)
+			free_.erase(free_.begin() + i);
+		return offset;
+	}
+
+	// Append, starting in the gap at the end of the file if there is one
+	if (!free_.empty() && size_t(free_.back().offset) + free_.back().size == fileSize_)
+	{
+		uint32_t offset = free_.back().offset;
+		free_.pop_back();
+		return offset;
+	}
+
+	return uint32_t(fileSize_);
+}
+
+void RegionFile::ReleaseSpace(Slot space)
+{
+	if (space.size == 0)
+		return;
+
+	// Keep sorted and merge with touching neighbors
+	auto next = std::lower_bound(free_.begin(), free_.end(), space, [](const Slot &lhs, const Slot &rhs) { return lhs.offset < rhs.offset; });
+	if (next != free_.end() && space.offset + space.size == next->offset)
+	{
+		space.size += next->size;
+		next = free_.erase(next);
+	}
+
+	if (next != free_.begin())
+	{
+		Slot &previous = *(next - 1);
+		if (previous.offset + previous.size == space.offset)
+		{
+			previous.size += space.size;
+			return;
+		}
+	}
+
+	free_.insert(next, space);
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include <cstdio>
+
+// File of up to 32x32 chunk blobs behind an offset table
+//	Reads go through a memory mapping of the file, writes through normal file io; safe to use from several threads
+class RegionFile
+{
+public:
+	// Chunks along each side of a region
+	static const int regionSize = 32;
+	static const int chunkCount = regionSize * regionSize;
+
+	// The file is only created by the first write
+	RegionFile(const std::string &path);
+
+	// Copy the blob of a chunk at a local coord in [0, regionSize), false if it was never written
+	bool Read(int x, int z, std::vector<unsigned char> &out);
+
+	// Replace the blob of a chunk, it is on disk when this returns true
+	//	The new blob goes to free space and the old one stays valid until the table points past it, so a crash keeps either
+	bool Write(int x, int z, const unsigned char *data, size_t size);
+
+	// Get info
+	bool Exists() const; // has the file been written
+	size_t GetFileSize() const;
+
+	~RegionFile();
+
+private:
+	// Where a blob lives in the file, zero offset if missing
+	struct Slot
+	{
+		uint32_t offset;
+		uint32_t size;
+	};
+
+	static const uint32_t magic = 0x47525856; // "VXRG"
+	static const uint32_t version = 1;
+	static const size_t headerSize = sizeof(uint32_t) * 2 + sizeof(Slot) * chunkCount;
+
+	std::string path_;
+	std::mutex mutex_;
+	bool exists_;
+	size_t fileSize_;
+
+	// Space no slot points at, sorted by offset; found from the table on the first write
+	std::vector<Slot> free_;
+	bool freeKnown_;
+
+	// Read only mapping of the whole file, remapped after writes
+	const unsigned char *view_;
+	size_t viewSize_;
+	void *mapping_; // platform mapping handle
+
+	bool Map(); // map the current file, false if it can't be read
+	void Unmap();
+	bool ReadSlot(int index, Slot &slot); // slot from the mapped header
+	void FindFreeSpace(FILE *file); // gaps between the blobs the table points at
+	uint32_t AllocateSpace(size_t size); // offset of free space for a blob, appending if none fits
+	void ReleaseSpace(Slot space); // return space no slot points at anymore
+
+public: // Owns a mapping, disallow copies
+	RegionFile(RegionFile const &) = delete;
+	void operator=(RegionFile const &) = delete;
+};
@@ -0,0 +1,77 @@
+#include "SimplexNoise.h"
+#include "SimplexNoiseKernel.h"
+
+#include <glm/gtc/noise.hpp>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SIMPLEX_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+#endif
+
+// Widest instruction set the cpu and os support
+static SimplexNoise::Level DetectLevel()
+{
+#ifdef SIMPLEX_X86
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	int maxLeaf = info[0];
+
+	__cpuid(info, 1);
+	bool sse41 = (info[2] & (1 << 19)) != 0;
+	bool osSavesAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+
+	bool avx2 = false;
+	if (maxLeaf >= 7 && osSavesAvx)
+	{
+		__cpuidex(info, 7, 0);
+		avx2 = (info[1] & (1 << 5)) != 0;
+	}
+#else
+	__builtin_cpu_init();
+	bool sse41 = __builtin_cpu_supports("sse4.1");
+	bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+
+	if (avx2 && sse41)
+		return SimplexNoise::LEVEL_AVX2;
+	if (sse41)
+		return SimplexNoise::LEVEL_SSE41;
+#endif
+
+	return SimplexNoise::LEVEL_SCALAR;
+}
+
+void SimplexNoise::Evaluate(const float *x, const float *y, float *out, size_t count)
+{
+	Evaluate(x, y, out, count, GetSupportedLevel());
+}
+
+void SimplexNoise::Evaluate(const float *x, const float *y, float *out, size_t count, Level level)
+{
+	size_t done = 0;
+	if (level == LEVEL_AVX2)
+		done = EvaluateAvx2(x, y, out, count);
+
+	// Avx leftovers fit sse
+	if (level >= LEVEL_SSE41)
+		done += EvaluateSse41(x + done, y + done, out + done, count - done);
+
+	for (size_t i = done; i < count; i++)
+		out[i] = glm::simplex(glm::vec2(x[i], y[i]));
+}
+
+SimplexNoise::Level SimplexNoise::GetSupportedLevel()
+{
+	static const Level level = DetectLevel();
+	return level;
+}
+
+const char *SimplexNoise::GetLevelName(Level level)
+{
+	static const char *const names[LEVEL_COUNT] = { "scalar", "SSE4.1", "AVX2" };
+	return level < LEVEL_COUNT ? names[level] : "unknown";
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+
+// 2D simplex noise over many points at once, matching glm::simplex bit for bit
+//	Runs 4 or 8 points per instruction with the widest instruction set the cpu supports
+namespace SimplexNoise
+{
+	// Instruction sets, each level needs the ones below it
+	enum Level
+	{
+		LEVEL_SCALAR,
+		LEVEL_SSE41,
+		LEVEL_AVX2,
+
+		LEVEL_COUNT
+	};
+
+	// Noise at each point (x[i], y[i]) into out[i]
+	void Evaluate(const float *x, const float *y, float *out, size_t count);
+
+	// Same, forcing an instruction set level the cpu supports
+	void Evaluate(const float *x, const float *y, float *out, size_t count, Level level);
+
+	// Get info
+	Level GetSupportedLevel(); // widest level this cpu runs
+	const char *GetLevelName(Level level);
+}
@@ -0,0 +1,61 @@
+// AVX2 simplex noise, only called when the cpu supports it
+//	Includes nothing but intrinsics and the kernel, so no shared inline code is built for this instruction set
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC target("avx2")
+#elif defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#endif
+
+#include <immintrin.h>
+
+#define SIMPLEX_KERNEL
+#include "SimplexNoiseKernel.h"
+
+namespace SimplexNoise
+{
+	namespace
+	{
+		// 8 points at a time
+		struct Avx2
+		{
+			typedef __m256 Type;
+			static const size_t width = 8;
+
+			static Type Set(float value) { return _mm256_set1_ps(value); }
+			static Type Load(const float *values) { return _mm256_loadu_ps(values); }
+			static void Store(float *values, Type value) { _mm256_storeu_ps(values, value); }
+			static Type Add(Type a, Type b) { return _mm256_add_ps(a, b); }
+			static Type Sub(Type a, Type b) { return _mm256_sub_ps(a, b); }
+			static Type Mul(Type a, Type b) { return _mm256_mul_ps(a, b); }
+			static Type Div(Type a, Type b) { return _mm256_div_ps(a, b); }
+			static Type Max(Type a, Type b) { return _mm256_max_ps(a, b); }
+			static Type Floor(Type a) { return _mm256_floor_ps(a); }
+			static Type Abs(Type a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+			static Type Greater(Type a, Type b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+			static Type Select(Type mask, Type ifTrue, Type ifFalse) { return _mm256_blendv_ps(ifFalse, ifTrue, mask); }
+		};
+	}
+
+	size_t EvaluateAvx2(const float *x, const float *y, float *out, size_t count)
+	{
+		return EvaluateKernel<Avx2>(x, y, out, count);
+	}
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#endif
+
+#else
+
+#include "SimplexNoiseKernel.h"
+
+size_t SimplexNoise::EvaluateAvx2(const float *, const float *, float *, size_t)
+{
+	return 0;
+}
+
+#endif
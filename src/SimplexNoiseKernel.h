@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+
+// Vector simplex noise shared by each instruction set's translation unit
+//	Every operation mirrors glm::simplex in the same order, so results round identically; no fused multiply-adds
+namespace SimplexNoise
+{
+	// Instruction set implementations, each returns how many points it did from the front, the rest are left to scalar code
+	size_t EvaluateSse41(const float *x, const float *y, float *out, size_t count);
+	size_t EvaluateAvx2(const float *x, const float *y, float *out, size_t count);
+
+#ifdef SIMPLEX_KERNEL
+	namespace
+	{
+		// Noise at V::width points per iteration, V wraps one instruction set's vector operations
+		template <typename V>
+		size_t EvaluateKernel(const float *xs, const float *ys, float *out, size_t count)
+		{
+			typedef typename V::Type T;
+
+			// Constants converted from double like glm's
+			const T c0 = V::Set(float(0.211324865405187)); // (3.0 - sqrt(3.0)) / 6.0
+			const T c1 = V::Set(float(0.366025403784439)); // 0.5 * (sqrt(3.0) - 1.0)
+			const T c2 = V::Set(float(-0.577350269189626)); // -1.0 + 2.0 * c0
+			const T c3 = V::Set(float(0.024390243902439)); // 1.0 / 41.0
+			const T zero = V::Set(0.0f);
+			const T half = V::Set(0.5f);
+			const T one = V::Set(1.0f);
+			const T two = V::Set(2.0f);
+			const T ring = V::Set(289.0f);
+			const T ringInverse = V::Set(1.0f / 289.0f);
+			const T thirtyFour = V::Set(34.0f);
+			const T taylorA = V::Set(float(1.79284291400159));
+			const T taylorB = V::Set(float(0.85373472095314));
+			const T scale = V::Set(130.0f);
+
+			auto mod289 = [&](T x) { return V::Sub(x, V::Mul(V::Floor(V::Mul(x, ringInverse)), ring)); };
+			auto permute = [&](T x) { return mod289(V::Mul(V::Add(V::Mul(x, thirtyFour), one), x)); };
+
+			size_t done = 0;
+			for (; done + V::width <= count; done += V::width)
+			{
+				T vx = V::Load(xs + done);
+				T vy = V::Load(ys + done);
+
+				// First corner
+				T skew = V::Add(V::Mul(vx, c1), V::Mul(vy, c1));
+				T ix = V::Floor(V::Add(vx, skew));
+				T iy = V::Floor(V::Add(vy, skew));
+				T unskew = V::Add(V::Mul(ix, c0), V::Mul(iy, c0));
+				T x0x = V::Add(V::Sub(vx, ix), unskew);
+				T x0y = V::Add(V::Sub(vy, iy), unskew);
+
+				// Other corners
+				T greater = V::Greater(x0x, x0y);
+				T i1x = V::Select(greater, one, zero);
+				T i1y = V::Select(greater, zero, one);
+				T x1x = V::Sub(V::Add(x0x, c0), i1x);
+				T x1y = V::Sub(V::Add(x0y, c0), i1y);
+				T x2x = V::Add(x0x, c2);
+				T x2y = V::Add(x0y, c2);
+
+				// Permutations
+				ix = V::Sub(ix, V::Mul(ring, V::Floor(V::Div(ix, ring))));
+				iy = V::Sub(iy, V::Mul(ring, V::Floor(V::Div(iy, ring))));
+				T p0 = permute(V::Add(V::Add(permute(V::Add(iy, zero)), ix), zero));
+				T p1 = permute(V::Add(V::Add(permute(V::Add(iy, i1y)), ix), i1x));
+				T p2 = permute(V::Add(V::Add(permute(V::Add(iy, one)), ix), one));
+
+				T m0 = V::Max(V::Sub(half, V::Add(V::Mul(x0x, x0x), V::Mul(x0y, x0y))), zero);
+				T m1 = V::Max(V::Sub(half, V::Add(V::Mul(x1x, x1x), V::Mul(x1y, x1y))), zero);
+				T m2 = V::Max(V::Sub(half, V::Add(V::Mul(x2x, x2x), V::Mul(x2y, x2y))), zero);
+				m0 = V::Mul(m0, m0);
+				m1 = V::Mul(m1, m1);
+				m2 = V::Mul(m2, m2);
+				m0 = V::Mul(m0, m0);
+				m1 = V::Mul(m1, m1);
+				m2 = V::Mul(m2, m2);
+
+				// Gradient of one corner scaled by its falloff
+				auto gradient = [&](T p, T m, T x, T y)
+				{
+					T scaled = V::Mul(p, c3);
+					T g = V::Sub(V::Mul(two, V::Sub(scaled, V::Floor(scaled))), one);
+					T h = V::Sub(V::Abs(g), half);
+					T a0 = V::Sub(g, V::Floor(V::Add(g, half)));
+					m = V::Mul(m, V::Sub(taylorA, V::Mul(taylorB, V::Add(V::Mul(a0, a0), V::Mul(h, h)))));
+					return V::Mul(m, V::Add(V::Mul(a0, x), V::Mul(h, y)));
+				};
+
+				T sum = V::Add(V::Add(gradient(p0, m0, x0x, x0y), gradient(p1, m1, x1x, x1y)), gradient(p2, m2, x2x, x2y));
+				V::Store(out + done, V::Mul(scale, sum));
+			}
+
+			return done;
+		}
+	}
+#endif
+}
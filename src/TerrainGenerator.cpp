@@ -1,5 +1,6 @@
 #include "TerrainGenerator.h"
 #include "WorldConstants.h"
+#include "SimplexNoise.h"
 
 #include <glm/gtc/noise.hpp>
 #include <glm/gtx/compatibility.hpp>
@@ -7,6 +8,9 @@
 #include <glm/gtx/hash.hpp>
 
 #include <random>
+#include <algorithm>
+#include <iterator>
+#include <cstdint>
 
 namespace Gen = World::Generation;
 
@@ -23,8 +27,12 @@ const int TerrainGenerator::tree[10][7][7] = {
 	{{ 0, 0, 0, 0, 0, 0, 0 },{ 0, 0, 0, 0, 0, 0, 0 },{ 0, 0, 0, 5, 0, 0, 0 },{ 0, 0, 5, 5, 5, 0, 0 },{ 0, 0, 0, 5, 0, 0, 0 },{ 0, 0, 0, 0, 0, 0, 0 },{ 0, 0, 0, 0, 0, 0, 0 }},
 	{{ 0, 0, 0, 0, 0, 0, 0 },{ 0, 0, 0, 0, 0, 0, 0 },{ 0, 0, 0, 0, 0, 0, 0 },{ 0, 0, 0, 5, 0, 0, 0 },{ 0, 0, 0, 0, 0, 0, 0 },{ 0, 0, 0, 0, 0, 0, 0 },{ 0, 0, 0, 0, 0, 0, 0 }},
 };
+static_assert((std::size(*TerrainGenerator::tree) - 1) / 2 <= TerrainGenerator::featureReach, "trees reach past featureReach");
 
-int TerrainGenerator::GetHeight(glm::vec2 pos)
+// Interpolate the height at coord between grid corners, corner gives the noise height at one
+//	Shared by single lookups and height maps so both round the same way
+template <typename Corner>
+static int InterpolateHeight(glm::vec2 pos, Corner corner)
 {
 	// Get grid corners for interpolation
 	glm::vec2 scaled = pos / Gen::terrainInterpGrid;
@@ -32,16 +40,16 @@ int TerrainGenerator::GetHeight(glm::vec2 pos)
 	glm::vec2 max = glm::ceil(scaled) * Gen::terrainInterpGrid;
 
 	if (min == max)
-		return static_cast<int>(GetNoiseHeight(pos));
+		return static_cast<int>(corner(pos));
 
 	// Interpolate x and y
 	if (min.x != max.x && min.y != max.y)
 	{
 		// Get noise at each corner
-		float bl = GetNoiseHeight(min);
-		float tr = GetNoiseHeight(max);
-		float tl = GetNoiseHeight({ min.x, max.y });
-		float br = GetNoiseHeight({ max.x, min.y });
+		float bl = corner(min);
+		float tr = corner(max);
+		float tl = corner({ min.x, max.y });
+		float br = corner({ max.x, min.y });
 
 		// Interpolation values
 		float tx = (pos.x - min.x) / (max.x - min.x);
@@ -56,8 +64,8 @@ int TerrainGenerator::GetHeight(glm::vec2 pos)
 	}
 	
 	// Interpolate one dimension
-	float minH = GetNoiseHeight(min);
-	float maxH = GetNoiseHeight(max);
+	float minH = corner(min);
+	float maxH = corner(max);
 
 	if (min.x == max.x) // Interpolate y
 		return static_cast<int>(glm::lerp(minH, maxH, (pos.y - min.y) / (max.y - min.y)));
@@ -65,45 +73,261 @@ int TerrainGenerator::GetHeight(glm::vec2 pos)
 		return static_cast<int>(glm::lerp(minH, maxH, (pos.x - min.x) / (max.x - min.x)));
 }
 
-std::vector<glm::ivec2> TerrainGenerator::GenerateTreePoints(glm::ivec2 startCorner, glm::ivec2 endCorner)
+int HeightMap::Get(glm::ivec2 pos) const
+{
+	return heights[(pos.x - start.x) + (pos.y - start.y) * size.x];
+}
+
+int TerrainGenerator::GetHeight(glm::vec2 pos)
 {
-	std::vector<glm::ivec2> points;
-	std::hash<glm::ivec2> hash;
-	std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+	return InterpolateHeight(pos, [this](glm::vec2 corner) { return GetNoiseHeight(corner); });
+}
 
-	// Check each point for if a tree should be generated
-	for (int z = startCorner.y; z < endCorner.y; z++)
+void TerrainGenerator::GenerateHeightMap(glm::ivec2 start, glm::ivec2 size, HeightMap &map)
+{
+	map.start = start;
+	map.size = size;
+	map.heights.resize(size_t(size.x) * size.y);
+
+	// Grid corners covering the area, in grid units
+	glm::vec2 first = glm::floor(glm::vec2(start) / Gen::terrainInterpGrid);
+	glm::vec2 last = glm::ceil(glm::vec2(start + size - 1) / Gen::terrainInterpGrid);
+	glm::ivec2 corners = glm::ivec2(last - first) + 1;
+
+	// Noise at each corner once, every layer of every corner in one batch; columns between corners only interpolate
+	size_t count = size_t(corners.x) * corners.y;
+	static thread_local std::vector<float> noiseX, noiseY, noise, lattice;
+	noiseX.resize(count * 3);
+	noiseY.resize(count * 3);
+	noise.resize(count * 3);
+	lattice.resize(count);
+
+	for (int z = 0; z < corners.y; z++)
 	{
-		for (int x = startCorner.x; x < endCorner.x; x++)
+		for (int x = 0; x < corners.x; x++)
 		{
-			glm::ivec2 pos = { x, z };
-			std::default_random_engine rng(unsigned(hash(pos)));
+			glm::vec2 pos = (first + glm::vec2(x, z)) * Gen::terrainInterpGrid;
+			size_t i = x + z * corners.x;
+
+			glm::vec2 height = pos / float(Gen::heightScale);
+			glm::vec2 detail = pos / float(Gen::detailScale);
+			glm::vec2 land = pos / static_cast<float>(Gen::landScale);
+			noiseX[i] = height.x;
+			noiseY[i] = height.y;
+			noiseX[i + count] = detail.x;
+			noiseY[i + count] = detail.y;
+			noiseX[i + count * 2] = land.x;
+			noiseY[i + count * 2] = land.y;
+		}
+	}
+
+	SimplexNoise::Evaluate(noiseX.data(), noiseY.data(), noise.data(), count * 3);
+	for (size_t i = 0; i < count; i++)
+		lattice[i] = LayerHeight(noise[i], noise[i + count], noise[i + count * 2]);
+
+	auto corner = [&](glm::vec2 pos)
+	{
+		glm::ivec2 index = glm::ivec2(pos / Gen::terrainInterpGrid - first);
+		return lattice[index.x + index.y * corners.x];
+	};
+
+	for (int z = 0; z < size.y; z++)
+	{
+		for (int x = 0; x < size.x; x++)
+			map.heights[x + z * size.x] = InterpolateHeight(glm::vec2(start + glm::ivec2(x, z)), corner);
+	}
+}
+
+void TerrainGenerator::GetFeatureBlocks(glm::ivec2 chunk, const HeightMap &heights, std::vector<FeatureBlock> &blocks)
+{
+	blocks.clear();
 
-			// Generate tree if using coord as seed passes
-			if (dist(rng) <= Gen::treeDensity)
+	// Take this chunk's share from every chunk close enough to reach into it
+	const int reach = (featureReach + World::chunkSize - 1) / World::chunkSize;
+	for (int z = -reach; z <= reach; z++)
+	{
+		for (int x = -reach; x <= reach; x++)
+		{
+			glm::ivec2 offset = { x, z };
+			std::shared_ptr<const ChunkFeatures> features = GetChunkFeatures(chunk + offset, &heights);
+			for (const auto &share : features->blocks)
 			{
-				points.push_back(pos);
+				if (share.first == -offset)
+					blocks.insert(blocks.end(), share.second.begin(), share.second.end());
 			}
 		}
 	}
+}
 
-	return points;
+std::shared_ptr<const TerrainGenerator::ChunkFeatures> TerrainGenerator::GetChunkFeatures(glm::ivec2 chunk, const HeightMap *heights)
+{
+	{
+		std::lock_guard<std::mutex> lock(featureMutex_);
+		auto found = featureCache_.find(chunk);
+		if (found != featureCache_.end())
+			return found->second;
+	}
+
+	// Built without the lock, another thread may do the same chunk at once but gets the same result
+	std::shared_ptr<const ChunkFeatures> features = BuildChunkFeatures(chunk, heights);
+
+	std::lock_guard<std::mutex> lock(featureMutex_);
+	auto inserted = featureCache_.emplace(chunk, features);
+	if (inserted.second)
+	{
+		featureOrder_.push_back(chunk);
+		if (featureOrder_.size() > featureCacheCapacity)
+		{
+			featureCache_.erase(featureOrder_.front());
+			featureOrder_.pop_front();
+		}
+	}
+	return inserted.first->second;
+}
+
+std::shared_ptr<const TerrainGenerator::ChunkFeatures> TerrainGenerator::BuildChunkFeatures(glm::ivec2 chunk, const HeightMap *heights)
+{
+	std::shared_ptr<ChunkFeatures> features = std::make_shared<ChunkFeatures>();
+	std::vector<glm::ivec2> trees;
+	PlaceTrees(chunk, trees);
+	if (trees.empty())
+		return features;
+
+	// Tree bases need this chunk's heights, only generate them when the caller's don't cover it
+	glm::ivec2 base = chunk * int(World::chunkSize);
+	glm::ivec2 size = { World::chunkSize, World::chunkSize };
+	if (!heights || glm::any(glm::lessThan(base, heights->start)) || glm::any(glm::greaterThan(base + size, heights->start + heights->size)))
+	{
+		static thread_local HeightMap local;
+		GenerateHeightMap(base, size, local);
+		heights = &local;
+	}
+
+	glm::ivec3 treeSize = {
+		std::size(*tree),
+		std::size(tree),
+		std::size(**tree)
+	};
+	glm::ivec2 treeRad = {
+		(treeSize.x - 1) / 2,
+		(treeSize.z - 1) / 2
+	};
+
+	// Split every tree block by the chunk it lands in
+	for (glm::ivec2 point : trees)
+	{
+		int height = heights->Get(point);
+		for (int y = 0; y < treeSize.y && height + y < int(World::chunkHeight); y++)
+		{
+			for (int x = -treeRad.x; x <= treeRad.x; x++)
+			{
+				for (int z = -treeRad.y; z <= treeRad.y; z++)
+				{
+					Block block = { Block::BlockType(tree[y][x + treeRad.x][z + treeRad.y]) };
+					if (block.type == Block::BLOCK_AIR)
+						continue;
+
+					glm::ivec2 pos = point + glm::ivec2(x, z);
+					glm::ivec2 target = glm::floor(glm::vec2(pos) / float(World::chunkSize));
+					glm::ivec2 local = pos - target * int(World::chunkSize);
+
+					auto share = std::find_if(features->blocks.begin(), features->blocks.end(),
+						[&](const auto &entry) { return entry.first == target - chunk; });
+					if (share == features->blocks.end())
+						share = features->blocks.insert(features->blocks.end(), { target - chunk, {} });
+
+					// Only allow leaves to replace air
+					share->second.push_back({
+						(unsigned char)local.x,
+						(unsigned char)(height + y),
+						(unsigned char)local.y,
+						block,
+						block.type == Block::BLOCK_LEAVES
+					});
+				}
+			}
+		}
+	}
+
+	return features;
+}
+
+// Scramble 32 bits so nearby inputs give unrelated outputs
+static uint32_t MixBits(uint32_t bits)
+{
+	bits ^= bits >> 16;
+	bits *= 0x7FEB352Du;
+	bits ^= bits >> 15;
+	bits *= 0x846CA68Bu;
+	bits ^= bits >> 16;
+	return bits;
+}
+
+// Random bits of a column from only the seed and coord, no generator state
+static uint32_t TreeHash(int x, int z)
+{
+	return MixBits(MixBits(Gen::treeSeed ^ uint32_t(x) * 0x9E3779B9u) ^ uint32_t(z) * 0x85EBCA6Bu);
+}
+
+void TerrainGenerator::PlaceTrees(glm::ivec2 chunk, std::vector<glm::ivec2> &points)
+{
+	glm::ivec2 base = chunk * int(World::chunkSize);
+
+	// Original placement seeds a generator from every coord
+	if (Gen::treeSeed == 0)
+	{
+		std::hash<glm::ivec2> hash;
+		std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+
+		// Check each point for if a tree should be generated
+		for (int z = base.y; z < base.y + int(World::chunkSize); z++)
+		{
+			for (int x = base.x; x < base.x + int(World::chunkSize); x++)
+			{
+				glm::ivec2 pos = { x, z };
+				std::default_random_engine rng(unsigned(hash(pos)));
+
+				// Generate tree if using coord as seed passes
+				if (dist(rng) <= Gen::treeDensity)
+				{
+					points.push_back(pos);
+				}
+			}
+		}
+		return;
+	}
+
+	// Hash every column without branches so the loop vectorizes, then gather the trees
+	const uint32_t threshold = uint32_t(double(Gen::treeDensity) * 4294967296.0);
+	unsigned char placed[World::chunkArea];
+	for (unsigned i = 0; i < World::chunkArea; i++)
+		placed[i] = TreeHash(base.x + int(i % World::chunkSize), base.y + int(i / World::chunkSize)) < threshold;
+
+	for (unsigned i = 0; i < World::chunkArea; i++)
+	{
+		if (placed[i])
+			points.push_back(base + glm::ivec2(i % World::chunkSize, i / World::chunkSize));
+	}
 }
 
 float TerrainGenerator::GetNoiseHeight(glm::vec2 pos)
 {
-	// Check cache
-	float cache = GetFromCache(pos);
-	if (cache > 0.0f)
-		return cache;
+	return LayerHeight(
+		glm::simplex(pos / float(Gen::heightScale)),
+		glm::simplex(pos / float(Gen::detailScale)),
+		glm::simplex(pos / static_cast<float>(Gen::landScale))
+	);
+}
 
+float TerrainGenerator::LayerHeight(float heightNoise, float detailNoise, float landNoise)
+{
 	// Calculate layered noise
-	float height = ((glm::simplex(pos / float(Gen::heightScale)) + 1) / 2) * Gen::heightWeight * Gen::heightMaxHeight +
-				   ((glm::simplex(pos / float(Gen::detailScale)) + 1) / 2) * Gen::detailWeight * Gen::detailMaxHeight;
+	float height = ((heightNoise + 1) / 2) * Gen::heightWeight * Gen::heightMaxHeight +
+				   ((detailNoise + 1) / 2) * Gen::detailWeight * Gen::detailMaxHeight;
 
 	// Apply biome height scalar
 	height *= (glm::clamp(
-		(glm::simplex(pos / static_cast<float>(Gen::landScale)) + Gen::landMountainBias * 2.0f) * Gen::landTransitionSharpness,
+		(landNoise + Gen::landMountainBias * 2.0f) * Gen::landTransitionSharpness,
 		-1.0f + Gen::landMinMult * 2.0f,
 		1.0f
 	) + 1.0f) / 2.0f;
@@ -111,28 +335,5 @@ float TerrainGenerator::GetNoiseHeight(glm::vec2 pos)
 	// Raise height by min
 	height += Gen::minHeight;
 
-	// Add and return
-	AddToCache(pos, height);
 	return height;
 }
-
-void TerrainGenerator::AddToCache(glm::vec2 pos, float height)
-{
-	if (cacheSize_ >= cacheCapacity)
-		cacheSize_ = 0; // Reset cache
-
-	// Add to cache
-	cache_[cacheSize_] = { height, pos };
-	cacheSize_++;
-}
-
-float TerrainGenerator::GetFromCache(glm::vec2 pos)
-{
-	// Search from end
-	for (int i = cacheSize_ - 1; i >= 0; i--)
-	{
-		if (cache_[i].pos == pos)
-			return cache_[i].height;
-	}
-	return 0.0f;
-}
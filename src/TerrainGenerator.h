@@ -1,38 +1,73 @@
 #pragma once
 
-#include <array>
 #include <vector>
+#include <deque>
+#include <unordered_map>
+#include <mutex>
+#include <memory>
 
-#include <glm/glm.hpp>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
 
-// Entry in cache
-struct HeightCache
+#include "Block.h"
+
+// Column heights of an area of terrain
+struct HeightMap
+{
+	glm::ivec2 start; // first column
+	glm::ivec2 size;
+	std::vector<int> heights; // x + z * size.x
+
+	int Get(glm::ivec2 pos) const; // height of a column inside the area
+};
+
+// Block a structure places, in local coords of the chunk it lands in
+struct FeatureBlock
 {
-	float height; // height zero = disabled
-	glm::vec2 pos;
+	unsigned char x, y, z;
+	Block block;
+	bool onlyAir; // only replaces air, like leaves
 };
 
 // Defines method of terrain generation
+//	Safe to use from several threads at once
 class TerrainGenerator
 {
 public:
 	// Get deterministic height value at coord
 	int GetHeight(glm::vec2 pos);
 
-	// Get deterministic tree points in area [start, end)
-	std::vector<glm::ivec2> GenerateTreePoints(glm::ivec2 startCorner, glm::ivec2 endCorner);
+	// Get the heights of an area in one pass, evaluating each interpolation grid corner once; matches GetHeight exactly
+	void GenerateHeightMap(glm::ivec2 start, glm::ivec2 size, HeightMap &map);
+
+	// Get every block structures place in a chunk, heights must cover the chunk
+	//	Each structure is built once by the chunk holding its origin and split by the chunks it lands in,
+	//	so neighbors only copy their share; blocks may be applied in any order
+	void GetFeatureBlocks(glm::ivec2 chunk, const HeightMap &heights, std::vector<FeatureBlock> &blocks);
 
 	// y, x, z
 	static const int tree[10][7][7];
 
+	// Farthest a structure reaches from its origin column
+	static const int featureReach = 3;
+
 private:
-	static const unsigned cacheCapacity = 128;
+	// Structures with their origin in a chunk
+	struct ChunkFeatures
+	{
+		std::vector<std::pair<glm::ivec2, std::vector<FeatureBlock>>> blocks; // by offset of the chunk they land in
+	};
+
+	// Chunks of structures kept
+	static const size_t featureCacheCapacity = 1024;
 
-	// Cache for height data
-	std::array<HeightCache, cacheCapacity> cache_;
-	unsigned cacheSize_ = 0;
+	std::mutex featureMutex_; // guards the feature cache
+	std::unordered_map<glm::ivec2, std::shared_ptr<const ChunkFeatures>> featureCache_;
+	std::deque<glm::ivec2> featureOrder_; // oldest first, evicted past capacity
 
+	std::shared_ptr<const ChunkFeatures> GetChunkFeatures(glm::ivec2 chunk, const HeightMap *heights); // cached, heights used if they cover the chunk
+	std::shared_ptr<const ChunkFeatures> BuildChunkFeatures(glm::ivec2 chunk, const HeightMap *heights);
+	static void PlaceTrees(glm::ivec2 chunk, std::vector<glm::ivec2> &points); // tree points of a chunk, ordered by z then x
 	float GetNoiseHeight(glm::vec2 pos); // Get height of raw noise
-	void AddToCache(glm::vec2 pos, float height); // Add height value to cache
-	float GetFromCache(glm::vec2 pos); // Retrieve height value from cache
+	static float LayerHeight(float heightNoise, float detailNoise, float landNoise); // Combine each noise layer at a point into a height
 };
\ No newline at end of file
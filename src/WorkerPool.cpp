@@ -0,0 +1,93 @@
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(unsigned threads)
+{
+	if (threads == 0)
+	{
+		unsigned cores = std::thread::hardware_concurrency();
+		threads = cores > 1 ? cores - 1 : 1;
+	}
+
+	for (unsigned i = 0; i < threads; i++)
+		threads_.emplace_back(&WorkerPool::Run, this);
+}
+
+void WorkerPool::Submit(float priority, std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (stopping_)
+			return;
+
+		jobs_.push({ priority, submitted_++, std::move(job) });
+	}
+	wake_.notify_one();
+}
+
+void WorkerPool::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopping_ = true;
+		jobs_ = {};
+	}
+	wake_.notify_all();
+
+	for (std::thread &thread : threads_)
+	{
+		if (thread.joinable())
+			thread.join();
+	}
+}
+
+size_t WorkerPool::GetQueuedCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return jobs_.size();
+}
+
+size_t WorkerPool::GetRunningCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return running_;
+}
+
+unsigned WorkerPool::GetThreadCount() const
+{
+	return unsigned(threads_.size());
+}
+
+WorkerPool::~WorkerPool()
+{
+	Stop();
+}
+
+bool WorkerPool::Job::operator<(const Job &rhs) const
+{
+	if (priority != rhs.priority)
+		return priority > rhs.priority;
+
+	return order > rhs.order;
+}
+
+void WorkerPool::Run()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	while (true)
+	{
+		wake_.wait(lock, [this]() { return stopping_ || !jobs_.empty(); });
+		if (stopping_)
+			return;
+
+		// Top is const, move the work out before popping
+		std::function<void()> work = std::move(const_cast<Job &>(jobs_.top()).work);
+		jobs_.pop();
+		running_++;
+
+		lock.unlock();
+		work();
+		lock.lock();
+
+		running_--;
+	}
+}
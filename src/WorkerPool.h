@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstdint>
+
+// Background threads running prioritized jobs
+//	Jobs must not touch graphics api objects, hand results back to the main thread instead
+class WorkerPool
+{
+public:
+	// Zero threads uses every core but the main thread's
+	WorkerPool(unsigned threads = 0);
+
+	// Queue a job, lower priority runs first and equal priorities run in submission order
+	void Submit(float priority, std::function<void()> job);
+
+	// Drop queued jobs and wait for running ones, no jobs run after this
+	void Stop();
+
+	// Get info
+	size_t GetQueuedCount() const; // jobs waiting for a thread
+	size_t GetRunningCount() const; // jobs on a thread right now
+	unsigned GetThreadCount() const;
+
+	~WorkerPool();
+
+private:
+	struct Job
+	{
+		float priority;
+		uint64_t order;
+		std::function<void()> work;
+
+		bool operator<(const Job &rhs) const; // reversed so the queue top is the next job
+	};
+
+	std::vector<std::thread> threads_;
+	std::priority_queue<Job> jobs_;
+	mutable std::mutex mutex_;
+	std::condition_variable wake_;
+	uint64_t submitted_ = 0;
+	size_t running_ = 0;
+	bool stopping_ = false;
+
+	void Run(); // worker thread loop
+
+public: // Threads reference the pool, disallow copies
+	WorkerPool(WorkerPool const &) = delete;
+	void operator=(WorkerPool const &) = delete;
+};
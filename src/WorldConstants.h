@@ -1,16 +1,31 @@
 #pragma once
 
+#include <cstddef>
+
 // Configurable world variables
 namespace World
 {
 #ifndef NDEBUG
 	const float renderDistance = 64.0f; // block render radius
-	const unsigned renderSpeed = 1; // chunks generated per frame
 #else
 	const float renderDistance = 400.0f; // block render radius
-	const unsigned renderSpeed = 2; // chunks generated per frame
 #endif
 
+	// Block data of unloaded chunks kept to skip generation when they load again
+	const size_t chunkCacheSize = 64 * 1024 * 1024; // bytes
+	const bool chunkCacheCompact = true; // shrink palettes of cached chunks to the blocks still used
+
+	// Main thread time per frame for adding generated chunks and uploading meshes
+	const float chunkFrameBudget = 0.004f; // seconds
+
+	// Estimated background job time kept queued per worker thread
+	const float chunkQueueTime = 0.008f; // seconds
+
+	// Chunk generation ahead of player movement
+	const float prefetchTime = 1.5f; // seconds of movement to look ahead
+	const float prefetchMinSpeed = 8.0f; // blocks per second before prefetching starts
+	const unsigned prefetchLimit = 256; // most chunks held by prefetching
+
 	// Entity gravity force
 	const float gravity = 20.0f;
 
@@ -20,6 +35,28 @@ namespace World
 	const unsigned chunkArea = chunkSize * chunkSize;
 	const unsigned chunkVolume = chunkArea * chunkHeight;
 
+	// Meshes float out past this, far enough past the render radius that moving back and forth doesn't reload them
+	const float unloadDistance = renderDistance + 2.0f * chunkSize;
+
+	// Directory of saved edits
+	const char *const saveDirectory = "world";
+
+	// Save block edits to a journal replayed over generated terrain, instead of whole edited chunks to region files
+	const bool saveEditJournal = true;
+
+	// Loaded chunks with edits are saved to region files this often, so the write-ahead log doesn't grow without bound
+	const float checkpointInterval = 30.0f;
+
+	// Memory caps, the render distance shrinks while over either one
+	const size_t chunkMemoryCap = size_t(1024) * 1024 * 1024; // bytes of block data, loaded and cached
+	const size_t meshMemoryCap = size_t(512) * 1024 * 1024; // bytes of chunk mesh buffers
+	const float minRenderDistance = 3.0f * chunkSize; // never shrunk past this
+
+	// Vertical chunk sections
+	const unsigned sectionHeight = 16;
+	const unsigned sectionCount = chunkHeight / sectionHeight;
+	const unsigned sectionVolume = chunkArea * sectionHeight;
+
 	// Chunk load in animation
 	const float chunkFloatDistance = chunkHeight / 2.f;
 	const float chunkFloatInSpeed = 1.0f;
@@ -49,6 +86,7 @@ namespace World
 
 		// Trees
 		const float treeDensity = 0.03f;
+		const unsigned treeSeed = 0; // zero keeps the trees of existing worlds with the slower standard library generator, new worlds can set any other seed for hashed placement
 
 		// Interpolation grid size
 		const float terrainInterpGrid = 4.0f;
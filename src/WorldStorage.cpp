@@ -0,0 +1,296 @@
+#include "WorldStorage.h"
+#include "WorldConstants.h"
+
+#include <filesystem>
+#include <algorithm>
+
+// First byte of every encoded chunk
+static const unsigned char encodingVersion = 1;
+
+// Wait after a failed write before the next one, doubled by each failure in a row
+static const std::chrono::milliseconds retryDelay(100);
+static const std::chrono::milliseconds maxRetryDelay(5000);
+
+// Floor division, negative coords round down
+static int FloorDiv(int value, int divisor)
+{
+	return (value >= 0 ? value : value - divisor + 1) / divisor;
+}
+
+WorldStorage::WorldStorage(const std::string &directory) : directory_(directory), directoryCreated_(false), writing_(false), stopping_(false), retryDelay_(retryDelay)
+{
+	thread_ = std::thread(&WorldStorage::Run, this);
+}
+
+bool WorldStorage::Load(glm::ivec2 coord, ChunkData &data)
+{
+	// Queued saves are newer than anything on disk
+	{
+		std::lock_guard<std::mutex> lock(saveMutex_);
+		auto found = pending_.find(coord);
+		if (found != pending_.end())
+		{
+			data = found->second.data;
+			data.modified = false;
+			stats_.loads++;
+			return true;
+		}
+	}
+
+	int x, z;
+	RegionFile &region = GetRegion(coord, x, z);
+
+	std::vector<unsigned char> bytes;
+	if (!region.Read(x, z, bytes) || !Decode(bytes.data(), bytes.size(), data))
+		return false;
+
+	std::lock_guard<std::mutex> lock(saveMutex_);
+	stats_.loads++;
+	stats_.bytesRead += bytes.size();
+	return true;
+}
+
+void WorldStorage::Save(glm::ivec2 coord, const ChunkData &data, uint64_t sequence)
+{
+	{
+		std::lock_guard<std::mutex> lock(saveMutex_);
+		auto found = pending_.find(coord);
+		if (found == pending_.end())
+		{
+			pending_[coord] = { data, 0, sequence };
+			order_.push_back(coord);
+		}
+		else
+		{
+			found->second.data = data;
+			found->second.version++;
+			found->second.sequence = std::max(found->second.sequence, sequence);
+		}
+		stats_.pending = pending_.size();
+	}
+	wake_.notify_one();
+}
+
+void WorldStorage::SetSavedCallback(std::function<void(glm::ivec2 coord, uint64_t sequence)> callback)
+{
+	std::lock_guard<std::mutex> lock(saveMutex_);
+	saved_ = std::move(callback);
+}
+
+void WorldStorage::Flush()
+{
+	std::unique_lock<std::mutex> lock(saveMutex_);
+	idle_.wait(lock, [this]() { return order_.empty() && !writing_; });
+}
+
+WorldStorage::Stats WorldStorage::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(saveMutex_);
+	return stats_;
+}
+
+void WorldStorage::Encode(const ChunkData &data, std::vector<unsigned char> &out)
+{
+	out.clear();
+	out.push_back(encodingVersion);
+
+	auto writeVarint = [&out](uint32_t value)
+	{
+		while (value >= 0x80)
+		{
+			out.push_back(static_cast<unsigned char>(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back(static_cast<unsigned char>(value));
+	};
+
+	writeVarint(uint32_t(data.highestSolidBlock));
+	writeVarint(uint32_t(data.sections.size()));
+
+	// Runs of one block type, in storage order each run is usually a row or a layer
+	for (const BlockStorage &section : data.sections)
+	{
+		if (section.IsUniform())
+		{
+			writeVarint(uint32_t(section.Size()));
+			out.push_back(section.GetUniform().type);
+			continue;
+		}
+
+		size_t start = 0;
+		Block current = section.Get(0);
+		for (size_t i = 1; i <= section.Size(); i++)
+		{
+			if (i < section.Size())
+			{
+				Block block = section.Get(i);
+				if (block == current)
+					continue;
+
+				writeVarint(uint32_t(i - start));
+				out.push_back(current.type);
+				current = block;
+			}
+			else
+			{
+				writeVarint(uint32_t(i - start));
+				out.push_back(current.type);
+			}
+			start = i;
+		}
+	}
+}
+
+bool WorldStorage::Decode(const unsigned char *bytes, size_t size, ChunkData &data)
+{
+	size_t position = 0;
+	auto readVarint = [&](uint32_t &value)
+	{
+		value = 0;
+		for (unsigned shift = 0; shift < 32; shift += 7)
+		{
+			if (position >= size)
+				return false;
+
+			unsigned char byte = bytes[position++];
+			value |= uint32_t(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0)
+				return true;
+		}
+		return false;
+	};
+
+	uint32_t highest, sectionCount;
+	if (size == 0 || bytes[position++] != encodingVersion || !readVarint(highest) || !readVarint(sectionCount) || sectionCount != World::sectionCount)
+		return false;
+
+	data.sections.assign(sectionCount, BlockStorage(World::sectionVolume));
+	data.highestSolidBlock = int(highest);
+	data.modified = false;
+
+	for (BlockStorage &section : data.sections)
+	{
+		size_t filled = 0;
+		while (filled < section.Size())
+		{
+			uint32_t length;
+			if (!readVarint(length) || position >= size || length == 0 || filled + length > section.Size())
+				return false;
+
+			Block block = { Block::BlockType(bytes[position++]) };
+
+			// Whole section runs skip the palette entirely
+			if (length == section.Size())
+				section.Fill(block);
+			else if (block.type != Block::BLOCK_AIR) // new storage is already air
+			{
+				for (size_t i = filled; i < filled + length; i++)
+					section.Set(i, block);
+			}
+			filled += length;
+		}
+	}
+
+	return position == size;
+}
+
+WorldStorage::~WorldStorage()
+{
+	// The thread writes what's queued before it stops
+	{
+		std::lock_guard<std::mutex> lock(saveMutex_);
+		stopping_ = true;
+	}
+	wake_.notify_all();
+	thread_.join();
+}
+
+RegionFile &WorldStorage::GetRegion(glm::ivec2 coord, int &x, int &z)
+{
+	glm::ivec2 region = { FloorDiv(coord.x, RegionFile::regionSize), FloorDiv(coord.y, RegionFile::regionSize) };
+	x = coord.x - region.x * RegionFile::regionSize;
+	z = coord.y - region.y * RegionFile::regionSize;
+
+	std::lock_guard<std::mutex> lock(regionsMutex_);
+	std::unique_ptr<RegionFile> &file = regions_[region];
+	if (file == nullptr)
+		file = std::make_unique<RegionFile>(directory_ + "/r." + std::to_string(region.x) + "." + std::to_string(region.y) + ".vxr");
+
+	return *file;
+}
+
+void WorldStorage::Run()
+{
+	std::unique_lock<std::mutex> lock(saveMutex_);
+	while (true)
+	{
+		wake_.wait(lock, [this]() { return stopping_ || !order_.empty(); });
+		if (order_.empty())
+			return;
+
+		// Copy out so saves can keep queuing while this one is written
+		glm::ivec2 coord = order_.front();
+		order_.pop_front();
+		PendingSave save = pending_[coord];
+		std::function<void(glm::ivec2, uint64_t)> saved = saved_;
+		writing_ = true;
+
+		lock.unlock();
+		bool written = WriteChunk(coord, save.data);
+		if (written && saved)
+			saved(coord, save.sequence);
+		lock.lock();
+
+		// Stays pending if it was saved again meanwhile or didn't make it to disk, loads keep seeing the newest data
+		auto found = pending_.find(coord);
+		if (written)
+		{
+			retryDelay_ = retryDelay;
+			if (found->second.version == save.version)
+				pending_.erase(found);
+			else
+				order_.push_back(coord);
+		}
+		else
+		{
+			stats_.failures++;
+			order_.push_back(coord);
+
+			// Back off so a failing disk isn't hammered, nothing is left to retry with once stopping
+			wake_.wait_for(lock, retryDelay_, [this]() { return stopping_; });
+			retryDelay_ = std::min(retryDelay_ * 2, maxRetryDelay);
+			if (stopping_)
+			{
+				pending_.erase(coord);
+				order_.erase(std::remove(order_.begin(), order_.end(), coord), order_.end());
+			}
+		}
+		stats_.pending = pending_.size();
+		writing_ = false;
+
+		if (order_.empty())
+			idle_.notify_all();
+	}
+}
+
+bool WorldStorage::WriteChunk(glm::ivec2 coord, const ChunkData &data)
+{
+	if (!directoryCreated_)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(directory_, error);
+		directoryCreated_ = true;
+	}
+
+	std::vector<unsigned char> bytes;
+	Encode(data, bytes);
+
+	int x, z;
+	if (!GetRegion(coord, x, z).Write(x, z, bytes.data(), bytes.size()))
+		return false;
+
+	std::lock_guard<std::mutex> lock(saveMutex_);
+	stats_.saves++;
+	stats_.bytesWritten += bytes.size();
+	return true;
+}
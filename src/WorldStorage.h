@@ -0,0 +1,97 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+
+#include "ChunkData.h"
+#include "RegionFile.h"
+
+// Saves and loads chunk block data in region files
+//	Saves are queued and written by a background thread; loads are safe from any thread and see queued saves
+class WorldStorage
+{
+public:
+	// Usage counters
+	struct Stats
+	{
+		size_t loads = 0; // chunks read from disk or the save queue
+		size_t saves = 0; // chunks written to disk
+		size_t bytesRead = 0; // compressed
+		size_t bytesWritten = 0;
+		size_t pending = 0; // saves waiting to be written
+		size_t failures = 0; // writes that didn't make it to disk
+	};
+
+	// Region files go in the directory, created on the first save
+	WorldStorage(const std::string &directory);
+
+	// Load a saved chunk, false if it was never saved
+	bool Load(glm::ivec2 coord, ChunkData &data);
+
+	// Queue a chunk to be written, replacing an older queued save of it
+	//	The sequence is handed to the saved callback once the data is on disk
+	void Save(glm::ivec2 coord, const ChunkData &data, uint64_t sequence = 0);
+
+	// Called on the save thread after each chunk is written
+	void SetSavedCallback(std::function<void(glm::ivec2 coord, uint64_t sequence)> callback);
+
+	// Wait until every queued save is written
+	void Flush();
+
+	// Get info
+	Stats GetStats() const;
+
+	// Compress chunk data with run lengths of blocks, and back
+	static void Encode(const ChunkData &data, std::vector<unsigned char> &out);
+	static bool Decode(const unsigned char *bytes, size_t size, ChunkData &data); // false if malformed
+
+	// Write what's queued, then stop; chunks that still fail to write are lost
+	~WorldStorage();
+
+private:
+	// Newest data queued for a chunk
+	struct PendingSave
+	{
+		ChunkData data;
+		unsigned version; // bumped by each save, so a newer save isn't dropped after an older one is written
+		uint64_t sequence;
+	};
+
+	std::string directory_;
+	bool directoryCreated_;
+
+	std::mutex regionsMutex_; // guards regions_
+	std::unordered_map<glm::ivec2, std::unique_ptr<RegionFile>> regions_;
+
+	mutable std::mutex saveMutex_; // guards everything below
+	std::condition_variable wake_;
+	std::condition_variable idle_;
+	std::unordered_map<glm::ivec2, PendingSave> pending_;
+	std::deque<glm::ivec2> order_; // oldest save first
+	bool writing_;
+	bool stopping_;
+	std::chrono::milliseconds retryDelay_; // before writing again after a failure
+	Stats stats_;
+	std::function<void(glm::ivec2, uint64_t)> saved_;
+	std::thread thread_;
+
+	RegionFile &GetRegion(glm::ivec2 coord, int &x, int &z); // region holding a chunk, and the chunk's coord inside it
+	void Run(); // save thread loop
+	bool WriteChunk(glm::ivec2 coord, const ChunkData &data);
+
+public: // Thread references the storage, disallow copies
+	WorldStorage(WorldStorage const &) = delete;
+	void operator=(WorldStorage const &) = delete;
+};
@@ -0,0 +1,390 @@
+#include "WriteAheadLog.h"
+#include "WorldConstants.h"
+#include "FileSync.h"
+
+#include <filesystem>
+#include <algorithm>
+
+// Edits logged this soon after the first one of a group share its commit
+static const std::chrono::milliseconds groupWindow(2);
+
+// Weight of each commit in the smoothed latency
+static const float latencySmoothing = 0.1f;
+
+// Wait after a failed commit before trying again
+static const std::chrono::milliseconds retryDelay(100);
+
+WriteAheadLog::WriteAheadLog(const std::string &directory, const std::string &name) :
+	directory_(directory),
+	path_(directory + "/" + name),
+	file_(nullptr),
+	sequence_(0),
+	committedSequence_(0),
+	dirtyRecords_(0),
+	fileRecords_(0),
+	rewriteQueued_(false),
+	writing_(false),
+	stopping_(false),
+	throughputStart_(Clock::now()),
+	throughputEdits_(0)
+{
+	Recover();
+	thread_ = std::thread(&WriteAheadLog::Run, this);
+}
+
+uint64_t WriteAheadLog::Append(glm::ivec2 coord, glm::ivec3 local, const Block &block)
+{
+	FileRecord record = { coord.x, coord.y, uint16_t(local.x + local.z * World::chunkSize + local.y * World::chunkArea), block.type, 0 };
+
+	uint64_t sequence;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (queued_.empty())
+			oldestQueued_ = Clock::now();
+		queued_.push_back(record);
+
+		sequence = ++sequence_;
+		dirty_[coord].push_back({ sequence, record });
+		dirtyRecords_++;
+
+		stats_.appended++;
+		stats_.pending = queued_.size();
+		stats_.dirtyChunks = dirty_.size();
+	}
+	wake_.notify_one();
+	return sequence;
+}
+
+void WriteAheadLog::Checkpoint(glm::ivec2 coord, uint64_t sequence)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	auto found = dirty_.find(coord);
+	if (found == dirty_.end())
+		return;
+
+	// Records after the sequence were made after the checkpointed data was copied, they're still needed
+	std::vector<LoggedRecord> &records = found->second;
+	auto kept = std::find_if(records.begin(), records.end(), [sequence](const LoggedRecord &logged) { return logged.sequence > sequence; });
+	dirtyRecords_ -= size_t(kept - records.begin());
+	records.erase(records.begin(), kept);
+
+	if (records.empty())
+	{
+		dirty_.erase(found);
+		recovered_.erase(coord);
+	}
+	stats_.dirtyChunks = dirty_.size();
+
+	QueueRewrite();
+}
+
+uint64_t WriteAheadLog::GetSequence(glm::ivec2 coord) const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto found = dirty_.find(coord);
+	return found != dirty_.end() ? found->second.back().sequence : 0;
+}
+
+bool WriteAheadLog::GetRecovered(glm::ivec2 coord, std::vector<Edit> &edits) const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto found = recovered_.find(coord);
+	if (found == recovered_.end())
+		return false;
+
+	edits.clear();
+	for (const LocalEdit &edit : found->second)
+	{
+		glm::ivec3 local = { edit.index % World::chunkSize, edit.index / World::chunkArea, edit.index / World::chunkSize % World::chunkSize };
+		edits.push_back({ local, edit.block });
+	}
+	return true;
+}
+
+std::vector<glm::ivec2> WriteAheadLog::GetRecoveredChunks() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	std::vector<glm::ivec2> coords;
+	coords.reserve(recovered_.size());
+	for (const auto &chunk : recovered_)
+		coords.push_back(chunk.first);
+	return coords;
+}
+
+void WriteAheadLog::Flush()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	idle_.wait(lock, [this]() { return queued_.empty() && !rewriteQueued_ && !writing_; });
+}
+
+WriteAheadLog::Stats WriteAheadLog::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return stats_;
+}
+
+WriteAheadLog::~WriteAheadLog()
+{
+	// The thread commits what's queued before it stops, retrying a failed commit once
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopping_ = true;
+	}
+	wake_.notify_all();
+	thread_.join();
+
+	if (file_ != nullptr)
+		std::fclose(file_);
+}
+
+void WriteAheadLog::Recover()
+{
+	FILE *file = std::fopen(path_.c_str(), "rb");
+	if (file == nullptr)
+		return;
+
+	// Anything that isn't a log is emptied
+	uint32_t header[2];
+	if (std::fread(header, sizeof(header), 1, file) != 1 || header[0] != magic || header[1] != version)
+	{
+		std::fclose(file);
+		rewriteQueued_ = true;
+		return;
+	}
+
+	// Every chunk in the log was edited after its last checkpoint, later records replace earlier ones for the same block
+	size_t records = 0;
+	FileRecord record;
+	while (std::fread(&record, sizeof(record), 1, file) == 1 && record.index < World::chunkVolume && record.type < Block::BLOCK_COUNT)
+	{
+		glm::ivec2 coord = { record.x, record.z };
+		dirty_[coord].push_back({ ++sequence_, record });
+		dirtyRecords_++;
+		records++;
+
+		Block block = { Block::BlockType(record.type) };
+		std::vector<LocalEdit> &edits = recovered_[coord];
+		auto found = std::find_if(edits.begin(), edits.end(), [&record](const LocalEdit &edit) { return edit.index == record.index; });
+		if (found != edits.end())
+			found->block = block;
+		else
+			edits.push_back({ record.index, block });
+	}
+	std::fclose(file);
+
+	// Drop a partial record left by a crash during a commit, appending after it would misalign the rest
+	std::error_code error;
+	committedSequence_ = sequence_;
+	fileRecords_ = records;
+	stats_.logBytes = headerSize + records * sizeof(FileRecord);
+	if (std::filesystem::file_size(path_, error) != stats_.logBytes)
+		std::filesystem::resize_file(path_, stats_.logBytes, error);
+
+	stats_.dirtyChunks = dirty_.size();
+}
+
+void WriteAheadLog::Run()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	while (true)
+	{
+		wake_.wait(lock, [this]() { return stopping_ || !queued_.empty() || rewriteQueued_; });
+		if (queued_.empty() && !rewriteQueued_)
+			return;
+
+		writing_ = true;
+		if (!queued_.empty())
+		{
+			// Give more edits a chance to share the commit, one sync costs about the same for any group size
+			wake_.wait_until(lock, oldestQueued_ + groupWindow, [this]() { return stopping_; });
+
+			// Every edit up to the newest one is either in the file or in this group
+			std::vector<FileRecord> records;
+			records.swap(queued_);
+			Clock::time_point oldest = oldestQueued_;
+			uint64_t newest = sequence_;
+
+			lock.unlock();
+			bool committed = Commit(records);
+			lock.lock();
+
+			if (committed)
+			{
+				Clock::time_point now = Clock::now();
+				float latency = std::chrono::duration<float>(now - oldest).count();
+				stats_.latency = stats_.commits == 0 ? latency : glm::mix(stats_.latency, latency, latencySmoothing);
+				stats_.maxLatency = std::max(stats_.maxLatency, latency);
+				stats_.committed += records.size();
+				stats_.commits++;
+
+				committedSequence_ = newest;
+				fileRecords_ += records.size();
+				QueueRewrite();
+
+				throughputEdits_ += records.size();
+				float elapsed = std::chrono::duration<float>(now - throughputStart_).count();
+				if (elapsed >= 1.0f)
+				{
+					stats_.throughput = throughputEdits_ / elapsed;
+					throughputStart_ = now;
+					throughputEdits_ = 0;
+				}
+			}
+			else
+			{
+				stats_.failures++;
+
+				// Keep the group in order ahead of newer edits, and drop whatever part of it reached the file
+				queued_.insert(queued_.begin(), records.begin(), records.end());
+				oldestQueued_ = oldest;
+
+				lock.unlock();
+				Cut();
+				lock.lock();
+
+				// Nothing is left to retry with once stopping, the edits are lost
+				wake_.wait_for(lock, retryDelay, [this]() { return stopping_; });
+				if (stopping_)
+					queued_.clear();
+			}
+		}
+		else
+		{
+			// Snapshot what's still needed from the file, queued records are appended after the rewrite
+			std::vector<LoggedRecord> kept;
+			for (const auto &chunk : dirty_)
+			{
+				for (const LoggedRecord &logged : chunk.second)
+				{
+					if (logged.sequence <= committedSequence_)
+						kept.push_back(logged);
+				}
+			}
+			rewriteQueued_ = false;
+
+			// Chunks were gathered in any order, the file keeps edits in the order they were made
+			std::sort(kept.begin(), kept.end(), [](const LoggedRecord &lhs, const LoggedRecord &rhs) { return lhs.sequence < rhs.sequence; });
+			std::vector<FileRecord> records;
+			records.reserve(kept.size());
+			for (const LoggedRecord &logged : kept)
+				records.push_back(logged.record);
+
+			lock.unlock();
+			bool rewritten = Rewrite(records);
+			lock.lock();
+
+			if (rewritten)
+			{
+				fileRecords_ = records.size();
+				stats_.rewrites++;
+			}
+			else
+				stats_.failures++;
+		}
+
+		stats_.logBytes = headerSize + fileRecords_ * sizeof(FileRecord);
+		stats_.pending = queued_.size();
+		writing_ = false;
+
+		if (queued_.empty() && !rewriteQueued_)
+			idle_.notify_all();
+	}
+}
+
+void WriteAheadLog::QueueRewrite()
+{
+	if (rewriteQueued_ || fileRecords_ == 0)
+		return;
+
+	// Nothing needed empties the file right away, otherwise wait until rewriting drops most of it
+	if (dirtyRecords_ == 0 || (fileRecords_ >= rewriteMinimum && fileRecords_ > dirtyRecords_ * rewriteRatio))
+	{
+		rewriteQueued_ = true;
+		wake_.notify_one();
+	}
+}
+
+bool WriteAheadLog::Commit(const std::vector<FileRecord> &records)
+{
+	if (file_ == nullptr && !OpenFile())
+		return false;
+
+	bool written = std::fwrite(records.data(), sizeof(FileRecord), records.size(), file_) == records.size();
+	return SyncFile(file_) && written;
+}
+
+void WriteAheadLog::Cut()
+{
+	if (file_ != nullptr)
+	{
+		std::fclose(file_);
+		file_ = nullptr;
+	}
+
+	// A partial record would misalign every later one, the next commit reopens after the last good record
+	std::error_code error;
+	if (fileRecords_ == 0)
+		std::filesystem::remove(path_, error);
+	else
+		std::filesystem::resize_file(path_, headerSize + fileRecords_ * sizeof(FileRecord), error);
+}
+
+bool WriteAheadLog::Rewrite(const std::vector<FileRecord> &records)
+{
+	if (file_ != nullptr)
+	{
+		std::fclose(file_);
+		file_ = nullptr;
+	}
+
+	// Written beside the log then swapped in, so a crash keeps one complete copy
+	std::string temporary = path_ + ".tmp";
+	FILE *file = std::fopen(temporary.c_str(), "wb");
+	if (file == nullptr)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(directory_, error);
+		file = std::fopen(temporary.c_str(), "wb");
+		if (file == nullptr)
+			return false;
+	}
+
+	// On disk before the rename, otherwise a crash could swap in an empty or partial file
+	uint32_t header[2] = { magic, version };
+	bool written =
+		std::fwrite(header, sizeof(header), 1, file) == 1 &&
+		std::fwrite(records.data(), sizeof(FileRecord), records.size(), file) == records.size() &&
+		SyncFile(file);
+	written = std::fclose(file) == 0 && written;
+
+	// The next commit opens the new file
+	std::error_code error;
+	if (written)
+		std::filesystem::rename(temporary, path_, error);
+
+	return written && !error;
+}
+
+bool WriteAheadLog::OpenFile()
+{
+	file_ = std::fopen(path_.c_str(), "ab");
+	if (file_ == nullptr)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(directory_, error);
+		file_ = std::fopen(path_.c_str(), "ab");
+		if (file_ == nullptr)
+			return false;
+	}
+
+	// New files start with the header
+	std::fseek(file_, 0, SEEK_END);
+	if (std::ftell(file_) == 0)
+	{
+		uint32_t header[2] = { magic, version };
+		if (std::fwrite(header, sizeof(header), 1, file_) != 1)
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+
+#include "Block.h"
+
+// Log of block edits made since their chunks were last written to disk, so a crash loses none of them
+//	A background thread appends edits in groups with one disk sync each; once checkpoints leave most records stale, the log is rewritten with the rest
+class WriteAheadLog
+{
+public:
+	// Block changed inside a chunk
+	struct Edit
+	{
+		glm::ivec3 local; // block coord within the chunk
+		Block block;
+	};
+
+	// Usage counters
+	struct Stats
+	{
+		size_t appended = 0; // edits logged
+		size_t committed = 0; // edits synced to disk
+		size_t commits = 0; // disk syncs, each covers a group of edits
+		size_t pending = 0; // edits waiting for a commit
+		size_t dirtyChunks = 0; // chunks with logged edits that aren't checkpointed yet
+		size_t logBytes = 0;
+		size_t rewrites = 0; // times checkpointed records were dropped from the file
+		size_t failures = 0; // commits that didn't make it to disk
+		float latency = 0.0f; // smoothed seconds from logging an edit to its commit
+		float maxLatency = 0.0f;
+		float throughput = 0.0f; // edits committed per second, over the last second with commits
+	};
+
+	// Reads edits left in the log by a previous run, they're recovered until their chunks are checkpointed
+	WriteAheadLog(const std::string &directory, const std::string &name);
+
+	// Log a block edit to a chunk, never waits on the disk; returns the edit's sequence number
+	uint64_t Append(glm::ivec2 coord, glm::ivec3 local, const Block &block);
+
+	// A chunk's data with every edit up to the sequence is on disk, safe from any thread
+	void Checkpoint(glm::ivec2 coord, uint64_t sequence);
+
+	// Sequence of the newest logged edit of a chunk, zero if it has none since its last checkpoint
+	uint64_t GetSequence(glm::ivec2 coord) const;
+
+	// Edits a previous run logged to a chunk but never checkpointed, in the order they should be applied; false if none
+	bool GetRecovered(glm::ivec2 coord, std::vector<Edit> &edits) const;
+
+	// Chunks with edits from a previous run that aren't checkpointed yet
+	std::vector<glm::ivec2> GetRecoveredChunks() const;
+
+	// Wait until every logged edit is committed
+	void Flush();
+
+	// Get info
+	Stats GetStats() const;
+
+	// Commit what's logged, then stop; edits that still fail to commit are lost
+	~WriteAheadLog();
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	// Record as stored in the file
+	struct FileRecord
+	{
+		int32_t x; // chunk coord
+		int32_t z;
+		uint16_t index; // local block, x + z * size + y * area
+		uint8_t type;
+		uint8_t padding;
+	};
+
+	// Record logged since its chunk's last checkpoint
+	struct LoggedRecord
+	{
+		uint64_t sequence;
+		FileRecord record;
+	};
+
+	// Edit inside a chunk
+	struct LocalEdit
+	{
+		uint16_t index;
+		Block block;
+	};
+
+	static const uint32_t magic = 0x4C575856; // "VXWL"
+	static const uint32_t version = 1;
+	static const size_t headerSize = sizeof(uint32_t) * 2;
+
+	// Rewrite once records in the file outnumber the ones still needed by this much, and there are at least this many
+	static const size_t rewriteRatio = 2;
+	static const size_t rewriteMinimum = 1024;
+
+	std::string directory_;
+	std::string path_;
+	FILE *file_; // open for appending, log thread only
+
+	mutable std::mutex mutex_; // guards everything below
+	std::condition_variable wake_;
+	std::condition_variable idle_;
+	std::vector<FileRecord> queued_; // oldest first
+	Clock::time_point oldestQueued_; // when the first queued edit was logged
+	uint64_t sequence_; // of the newest edit
+	uint64_t committedSequence_; // of the newest edit in the file
+	std::unordered_map<glm::ivec2, std::vector<LoggedRecord>> dirty_; // records of each chunk that aren't checkpointed, oldest first
+	size_t dirtyRecords_; // records in dirty_
+	size_t fileRecords_; // records in the file, checkpointed ones included
+	std::unordered_map<glm::ivec2, std::vector<LocalEdit>> recovered_; // edits from a previous run
+	bool rewriteQueued_; // file holds mostly checkpointed records
+	bool writing_;
+	bool stopping_;
+	Clock::time_point throughputStart_;
+	size_t throughputEdits_; // committed since throughputStart_
+	Stats stats_;
+	std::thread thread_;
+
+	void Recover(); // read the file left by a previous run
+	void Run(); // log thread loop
+	void QueueRewrite(); // if checkpointed records are most of the file, lock held
+	bool Commit(const std::vector<FileRecord> &records); // append and sync to disk
+	void Cut(); // close the file and drop anything past the committed records, after a failed commit
+	bool Rewrite(const std::vector<FileRecord> &records); // replace the file with only these records
+	bool OpenFile(); // open for appending, creating the file and directory if needed
+
+public: // Thread references the log, disallow copies
+	WriteAheadLog(WriteAheadLog const &) = delete;
+	void operator=(WriteAheadLog const &) = delete;
+};
@@ -48,7 +48,7 @@ int main(int argc, char *argv[])
 		windowManager.Update(deltaTime);
 		player.Update(deltaTime);
 		networkManager.Update(player);
-		chunkManager.UpdateChunks(player.GetCamera().GetPosition(), deltaTime);
+		chunkManager.UpdateChunks(player.GetCamera().GetPosition(), player.GetCamera().GetForward(), deltaTime);
 		inputManager.Update();
 
 		// Draw